@@ -56,40 +56,39 @@ def dehaze_image(hazy_img, patch_size=15, omega=0.9375, t0=0.1, r=60, eps=0.003)
     return dehazed_img, refined_transmission
 
 
-# Load the hazy image
-# r"C:\Users\Rohan\Downloads\archive\RESIDE-6K\training\hazy\4.jpg"
-# r"C:\Users\Rohan\Documents\Images\newyork.jpg"
-hazy_img = cv2.imread(r"C:\Users\Rohan\Documents\Images\canyon.jpg")
-hazy_img = cv2.cvtColor(hazy_img, cv2.COLOR_BGR2RGB)
-hazy_img = hazy_img.astype(np.float32) / 255.0
-
-# Dehaze
-dehazed_img, transmission_map = dehaze_image(hazy_img)
-
-# Display results
-plt.figure(figsize=(40,18))
-
-plt.subplot(1, 3, 1)
-plt.imshow(hazy_img)
-plt.title("Hazy Image")
-plt.axis("off")
-
-plt.subplot(1, 3, 2)
-plt.imshow(dehazed_img)
-plt.title("Dehazed Image")
-plt.axis("off")
-
-plt.subplot(1, 3, 3)
-plt.imshow(transmission_map, cmap='gray')
-plt.title("Transmission Map")
-plt.axis("off")
-
-plt.show()
-
-# Convert back to 0–255 uint8
-output_img = (dehazed_img * 255).astype(np.uint8)
-
-# Save as JPG using OpenCV
-# cv2.imwrite(r"C:\Users\Rohan\Documents\Images\dehazed_town.jpg", cv2.cvtColor(output_img, cv2.COLOR_RGB2BGR))
-
-
+if __name__ == "__main__":
+    # Load the hazy image
+    # r"C:\Users\Rohan\Downloads\archive\RESIDE-6K\training\hazy\4.jpg"
+    # r"C:\Users\Rohan\Documents\Images\newyork.jpg"
+    hazy_img = cv2.imread(r"C:\Users\Rohan\Documents\Images\canyon.jpg")
+    hazy_img = cv2.cvtColor(hazy_img, cv2.COLOR_BGR2RGB)
+    hazy_img = hazy_img.astype(np.float32) / 255.0
+
+    # Dehaze
+    dehazed_img, transmission_map = dehaze_image(hazy_img)
+
+    # Display results
+    plt.figure(figsize=(40,18))
+
+    plt.subplot(1, 3, 1)
+    plt.imshow(hazy_img)
+    plt.title("Hazy Image")
+    plt.axis("off")
+
+    plt.subplot(1, 3, 2)
+    plt.imshow(dehazed_img)
+    plt.title("Dehazed Image")
+    plt.axis("off")
+
+    plt.subplot(1, 3, 3)
+    plt.imshow(transmission_map, cmap='gray')
+    plt.title("Transmission Map")
+    plt.axis("off")
+
+    plt.show()
+
+    # Convert back to 0–255 uint8
+    output_img = (dehazed_img * 255).astype(np.uint8)
+
+    # Save as JPG using OpenCV
+    # cv2.imwrite(r"C:\Users\Rohan\Documents\Images\dehazed_town.jpg", cv2.cvtColor(output_img, cv2.COLOR_RGB2BGR))
@@ -2,9 +2,10 @@ import cv2
 import numpy as np
 
 def min_filter_3x3(channel):
-    """3x3 minimum filter using OpenCV erode (same as morphological minimum)."""
+    """3x3 minimum filter using OpenCV erode (same as morphological minimum).
+    REFLECT_101 matches np.pad(mode='reflect') in compute_ED and the C engine."""
     kernel = np.ones((3,3), dtype=np.uint8)
-    return cv2.erode(channel, kernel, borderType=cv2.BORDER_REFLECT)
+    return cv2.erode(channel, kernel, borderType=cv2.BORDER_REFLECT_101)
 
 def compute_atmospheric_light(img, sigma=0.875):
     """
@@ -79,9 +80,9 @@ def apply_filter_kernels(img, ED):
 
     # use filter2D per channel
     for c in range(3):
-        P0[:, :, c] = cv2.filter2D(img[:, :, c], -1, k0, borderType=cv2.BORDER_REFLECT)
-        P1[:, :, c] = cv2.filter2D(img[:, :, c], -1, k1, borderType=cv2.BORDER_REFLECT)
-        P2[:, :, c] = cv2.filter2D(img[:, :, c], -1, k2, borderType=cv2.BORDER_REFLECT)
+        P0[:, :, c] = cv2.filter2D(img[:, :, c], -1, k0, borderType=cv2.BORDER_REFLECT_101)
+        P1[:, :, c] = cv2.filter2D(img[:, :, c], -1, k1, borderType=cv2.BORDER_REFLECT_101)
+        P2[:, :, c] = cv2.filter2D(img[:, :, c], -1, k2, borderType=cv2.BORDER_REFLECT_101)
 
     return P0, P1, P2
 
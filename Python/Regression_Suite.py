@@ -0,0 +1,307 @@
+"""
+Quality / speed regression suite for the haze removal engines.
+
+Runs every engine variant over the bundled 512x512 BMPs and a set of synthetic
+edge patterns, and reports PSNR / SSIM / max-abs-diff against the floating-point
+Shiau et al. (2013) reference in HazeRemoval.py, together with throughput.
+
+Variants:
+    c_sw       Vitis/SW_Implementation_ARM.c built with -DHOST_BUILD (gated)
+    c_sw_fp16  The same engine with the fp16 / fixed-point (RTL Q-format) transmission
+    c_sw_fixed and scene recovery tiers, -q fp16 / -q fixed (informational)
+    python_he  He et al. DCP + guided filter from Dehaze.py (different algorithm, informational)
+    skip check Frame-skip mode against full processing on repeated frames, with the
+               runtime parameters changed between them (gated, must be bit-exact)
+    external   Any pre-computed output BMP, e.g. the RTL testbench result_image.bmp
+               or the MATLAB output:  --external rtl canyon_512 Vivado/RTL/sim/result_image.bmp
+
+Usage:
+    python Regression_Suite.py [--c-binary haze_sw] [--min-psnr 40] [--max-diff 2]
+
+Exit status is 1 if any gated variant falls below the quality thresholds, so
+the script can gate every optimization of the C engine on correctness and speed.
+"""
+import argparse
+import glob
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+import cv2
+import numpy as np
+
+from HazeRemoval import dehaze_shiau
+
+REPO_ROOT = os.path.abspath(os.path.join(os.path.dirname(__file__), ".."))
+C_SOURCE = os.path.join(REPO_ROOT, "Vitis", "SW_Implementation_ARM.c")
+IMG_WIDTH = 512
+IMG_HEIGHT = 512
+
+
+# ------------------------------------------------------------------------------------------
+# Test images
+# ------------------------------------------------------------------------------------------
+def load_bundled_images():
+    """All 512x512 24-bit BMPs shipped with the repository (BGR uint8)."""
+    images = {}
+    paths = glob.glob(os.path.join(REPO_ROOT, "Vivado", "RTL", "sim", "*_512.bmp"))
+    paths += glob.glob(os.path.join(REPO_ROOT, "MATLAB", "*_512.bmp"))
+    for path in sorted(paths):
+        name = os.path.splitext(os.path.basename(path))[0]
+        img = cv2.imread(path, cv2.IMREAD_COLOR)
+        if img is None or img.shape[:2] != (IMG_HEIGHT, IMG_WIDTH) or name in images:
+            continue
+        images[name] = img
+    return images
+
+
+def synthetic_patterns():
+    """
+    Edge patterns that exercise each ED class and the boundary reflection.
+    The blue-only stripes specifically cover the per-channel vertical difference.
+    """
+    H, W = IMG_HEIGHT, IMG_WIDTH
+    yy, xx = np.mgrid[0:H, 0:W]
+    haze = np.array([200, 190, 180], dtype=np.uint8)  # BGR airlight-like background
+
+    def solid(mask, fg):
+        img = np.empty((H, W, 3), dtype=np.uint8)
+        img[:] = haze
+        img[mask] = fg
+        return img
+
+    patterns = {
+        "flat": solid(np.zeros((H, W), dtype=bool), haze),
+        "step_vertical": solid(xx >= W // 2, (40, 60, 80)),
+        "step_horizontal": solid(yy >= H // 2, (40, 60, 80)),
+        "step_diagonal": solid(xx > yy, (40, 60, 80)),
+        "checker_8": solid(((xx // 8) + (yy // 8)) % 2 == 1, (30, 30, 30)),
+        "blue_stripes_h": solid((yy // 4) % 2 == 1, (60, 190, 180)),
+        "saturated": solid(((xx // 32) + (yy // 32)) % 2 == 1, (255, 255, 255)),
+    }
+
+    ramp = np.empty((H, W, 3), dtype=np.uint8)
+    ramp[..., 0] = (xx * 255 // (W - 1)).astype(np.uint8)
+    ramp[..., 1] = (yy * 255 // (H - 1)).astype(np.uint8)
+    ramp[..., 2] = ((xx + yy) * 255 // (W + H - 2)).astype(np.uint8)
+    patterns["ramp"] = ramp
+    return patterns
+
+
+# ------------------------------------------------------------------------------------------
+# Metrics
+# ------------------------------------------------------------------------------------------
+def psnr(ref, img):
+    mse = np.mean((ref.astype(np.float64) - img.astype(np.float64)) ** 2)
+    if mse == 0:
+        return float("inf")
+    return 10.0 * np.log10(255.0 ** 2 / mse)
+
+
+def ssim(ref, img):
+    """Mean SSIM over channels with the usual 11x11 Gaussian window (sigma 1.5)."""
+    C1 = (0.01 * 255) ** 2
+    C2 = (0.03 * 255) ** 2
+    scores = []
+    for c in range(3):
+        x = ref[:, :, c].astype(np.float64)
+        y = img[:, :, c].astype(np.float64)
+        mu_x = cv2.GaussianBlur(x, (11, 11), 1.5)
+        mu_y = cv2.GaussianBlur(y, (11, 11), 1.5)
+        sxx = cv2.GaussianBlur(x * x, (11, 11), 1.5) - mu_x * mu_x
+        syy = cv2.GaussianBlur(y * y, (11, 11), 1.5) - mu_y * mu_y
+        sxy = cv2.GaussianBlur(x * y, (11, 11), 1.5) - mu_x * mu_y
+        num = (2 * mu_x * mu_y + C1) * (2 * sxy + C2)
+        den = (mu_x ** 2 + mu_y ** 2 + C1) * (sxx + syy + C2)
+        scores.append(np.mean(num / den))
+    return float(np.mean(scores))
+
+
+def max_abs_diff(ref, img):
+    return int(np.max(np.abs(ref.astype(np.int16) - img.astype(np.int16))))
+
+
+# ------------------------------------------------------------------------------------------
+# Engine variants
+# ------------------------------------------------------------------------------------------
+def build_c_engine(out_dir):
+    binary = os.path.join(out_dir, "haze_sw")
+    cmd = ["gcc", "-O3", "-DHOST_BUILD", C_SOURCE, "-o", binary, "-lm", "-pthread"]
+    subprocess.run(cmd, check=True)
+    return binary
+
+
+def run_c_engine(binary, images, extra_args=()):
+    """
+    Push all frames through one process (XRGB32 in, RGB24 out).
+    Returns {name: BGR uint8 output} and the engine's own Mpix/s figure.
+    """
+    names = list(images.keys())
+    # XRGB32 little-endian words are B,G,R,0 in memory, i.e. BGRA with A=0
+    payload = b"".join(
+        np.dstack([images[n], np.zeros((IMG_HEIGHT, IMG_WIDTH, 1), np.uint8)]).tobytes()
+        for n in names)
+    proc = subprocess.run([binary, *extra_args], input=payload, capture_output=True, check=True)
+
+    frame_bytes = IMG_WIDTH * IMG_HEIGHT * 3
+    outputs = {}
+    for k, n in enumerate(names):
+        rgb = np.frombuffer(proc.stdout[k * frame_bytes:(k + 1) * frame_bytes], np.uint8)
+        outputs[n] = cv2.cvtColor(rgb.reshape((IMG_HEIGHT, IMG_WIDTH, 3)), cv2.COLOR_RGB2BGR)
+
+    mpix_s = float("nan")
+    for line in proc.stderr.decode(errors="replace").splitlines():
+        fields = line.split()
+        if len(fields) == 6 and fields[0] == "FRAMES":
+            mpix_s = float(fields[5])
+    return outputs, mpix_s
+
+
+# Drives two workspaces, one in frame-skip mode, over the same frame three times and
+# changes the runtime parameters in between. With a zero SAD tolerance skip mode must
+# reproduce full processing exactly, including when only the parameters moved.
+SKIP_CHECK_SOURCE = r"""
+#define main haze_sw_main
+#include "SW_Implementation_ARM.c"
+#undef main
+
+int main(void) {
+    static u32 frame[IMG_SIZE];
+    static u8 out_full[NUMBER_OF_BYTES], out_skip[NUMBER_OF_BYTES];
+    HazeWorkspace full, skip;
+    HazeParams p = HazeParamsDefault;
+    Pixel_f ac;
+    int differ = 0;
+
+    if (fread(frame, sizeof(u32), IMG_SIZE, stdin) != IMG_SIZE ||
+        haze_workspace_alloc(&full) != 0 || haze_workspace_alloc(&skip) != 0)
+        return 2;
+    skip.frame_skip = 1;
+
+    for (int k = 0; k < 3; k++) {
+        if (k == 1) { p.omega = 0.8f; p.beta = 0.5f; }
+        if (k == 2) { p.t0 = 0.4f; }
+        haze_set_params(&full, &p);
+        haze_set_params(&skip, &p);
+        dehaze_frame(&full, frame, out_full, &ac);
+        dehaze_frame(&skip, frame, out_skip, &ac);
+        differ |= memcmp(out_full, out_skip, NUMBER_OF_BYTES) != 0;
+    }
+    return differ;
+}
+"""
+
+
+def check_skip_equivalence(out_dir, images):
+    """Returns the names of the images on which skip mode and full processing differ."""
+    source = os.path.join(out_dir, "skip_check.c")
+    binary = os.path.join(out_dir, "skip_check")
+    with open(source, "w") as f:
+        f.write(SKIP_CHECK_SOURCE)
+    cmd = ["gcc", "-O3", "-DHOST_BUILD", "-DHAZE_SKIP_SAD_PER_PIXEL=0",
+           "-I", os.path.dirname(C_SOURCE), source, "-o", binary, "-lm", "-pthread"]
+    subprocess.run(cmd, check=True)
+
+    failed = []
+    for name, img in images.items():
+        payload = np.dstack([img, np.zeros((IMG_HEIGHT, IMG_WIDTH, 1), np.uint8)]).tobytes()
+        if subprocess.run([binary], input=payload, capture_output=True).returncode != 0:
+            failed.append(name)
+    return failed
+
+
+def run_python_he(img_bgr):
+    # Deferred: Dehaze pulls in matplotlib, which --skip-he runs may not have
+    from Dehaze import dehaze_image
+
+    rgb = cv2.cvtColor(img_bgr, cv2.COLOR_BGR2RGB).astype(np.float32) / 255.0
+    out, _ = dehaze_image(rgb)
+    return cv2.cvtColor((out * 255).astype(np.uint8), cv2.COLOR_RGB2BGR)
+
+
+def timed(fn, *args):
+    t0 = time.perf_counter()
+    out = fn(*args)
+    elapsed = time.perf_counter() - t0
+    return out, (IMG_WIDTH * IMG_HEIGHT / 1e6) / elapsed
+
+
+# ------------------------------------------------------------------------------------------
+# Main
+# ------------------------------------------------------------------------------------------
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--c-binary", help="prebuilt HOST_BUILD engine (built with gcc if omitted)")
+    parser.add_argument("--external", nargs=3, action="append", default=[],
+                        metavar=("LABEL", "IMAGE", "BMP"),
+                        help="compare a pre-computed output BMP for the named input image")
+    parser.add_argument("--skip-he", action="store_true", help="skip the Dehaze.py variant")
+    parser.add_argument("--min-psnr", type=float, default=40.0)
+    parser.add_argument("--min-ssim", type=float, default=0.99)
+    parser.add_argument("--max-diff", type=int, default=2)
+    args = parser.parse_args()
+
+    images = load_bundled_images()
+    images.update(synthetic_patterns())
+
+    # Golden reference
+    golden, ref_speed = {}, []
+    for name, img in images.items():
+        (out, _), speed = timed(dehaze_shiau, img)
+        golden[name] = out
+        ref_speed.append(speed)
+
+    results = []  # (variant, image, psnr, ssim, maxdiff, mpix_s, gated)
+
+    with tempfile.TemporaryDirectory() as tmp:
+        binary = args.c_binary or build_c_engine(tmp)
+        c_out, c_speed = run_c_engine(binary, images)
+        tiers = {tier: run_c_engine(binary, images, ["-q", tier]) for tier in ("fp16", "fixed")}
+        skip_failed = check_skip_equivalence(tmp, images)
+    for name in images:
+        g = golden[name]
+        results.append(("c_sw", name, psnr(g, c_out[name]), ssim(g, c_out[name]),
+                        max_abs_diff(g, c_out[name]), c_speed, True))
+        for tier, (t_out, t_speed) in tiers.items():
+            results.append((f"c_sw_{tier}", name, psnr(g, t_out[name]), ssim(g, t_out[name]),
+                            max_abs_diff(g, t_out[name]), t_speed, False))
+
+    if not args.skip_he:
+        for name, img in images.items():
+            out, speed = timed(run_python_he, img)
+            g = golden[name]
+            results.append(("python_he", name, psnr(g, out), ssim(g, out),
+                            max_abs_diff(g, out), speed, False))
+
+    for label, name, path in args.external:
+        out = cv2.imread(path, cv2.IMREAD_COLOR)
+        if name not in golden or out is None or out.shape != golden[name].shape:
+            print(f"WARNING: cannot compare {label} output '{path}' against '{name}'")
+            continue
+        g = golden[name]
+        results.append((label, name, psnr(g, out), ssim(g, out),
+                        max_abs_diff(g, out), float("nan"), False))
+
+    # Report
+    print(f"Reference (HazeRemoval.py): {np.mean(ref_speed):.2f} Mpix/s")
+    print(f"{'variant':<12}{'image':<18}{'PSNR dB':>9}{'SSIM':>8}{'maxdiff':>9}{'Mpix/s':>9}  status")
+    failures = 0
+    for variant, name, p, s, d, speed, gated in results:
+        ok = p >= args.min_psnr and s >= args.min_ssim and d <= args.max_diff
+        status = ("PASS" if ok else "FAIL") if gated else "info"
+        failures += 0 if ok or not gated else 1
+        print(f"{variant:<12}{name:<18}{p:>9.2f}{s:>8.4f}{d:>9d}{speed:>9.2f}  {status}")
+
+    print(f"Skip mode vs full processing: "
+          f"{'FAIL on ' + ', '.join(skip_failed) if skip_failed else 'PASS'}")
+    failures += len(skip_failed)
+
+    print(f"{failures} gated failure(s)")
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,139 @@
+/**
+ * @file HazeRemoval_DmaBuffer.h
+ * @brief Cache-coherency-aware DMA buffer management for the AXI-DMA driver
+ * @description Carves cache-line-aligned buffers out of static pools and performs
+ *              cache maintenance only on the bytes a transfer touches, instead of
+ *              flushing the whole data cache around every frame:
+ *              - MM2S (DDR -> IP): clean (flush) the source range before the transfer
+ *              - S2MM (IP -> DDR): invalidate the destination range before the transfer
+ *                (so no dirty line is evicted on top of DMA data) and again after
+ *                completion (so the CPU does not read stale lines)
+ *              Buffers from a non-cacheable pool need no maintenance at all, which suits
+ *              streaming outputs that the CPU reads exactly once.
+ *
+ * @author Rohan M
+ * @date 18th October 2026
+ * @version 1.0
+ *
+ * Configuration:
+ * - HAZE_DMA_CACHE_LINE   Cache line size in bytes (Cortex-A9 L1/PL310 L2: 32)
+ */
+#ifndef HAZEREMOVAL_DMABUFFER_H
+#define HAZEREMOVAL_DMABUFFER_H
+
+#include "xil_types.h"
+#include "xil_cache.h"
+#include "xil_mmu.h"
+#include "xpseudo_asm.h"
+
+//==========================================================================================
+// CONFIGURATION
+//==========================================================================================
+#ifndef HAZE_DMA_CACHE_LINE
+#define HAZE_DMA_CACHE_LINE      32
+#endif
+
+#define HAZE_DMA_SECTION_SIZE    0x100000   /**< MMU section (1 MB): granule for non-cacheable pools */
+
+#define HAZE_DMA_ALIGN_UP(x, a)  (((x) + ((a) - 1)) & ~((a) - 1))
+
+//==========================================================================================
+// TYPE DEFINITIONS
+//==========================================================================================
+typedef struct {
+    u8  *base;              /**< Pool memory (cache-line aligned, section aligned if non-cacheable) */
+    u32  size;              /**< Pool size in bytes */
+    u32  used;              /**< Bytes handed out so far */
+    int  cacheable;         /**< 0 = mapped NORM_NONCACHE, no maintenance needed */
+} HazeDmaPool;
+
+typedef struct {
+    void *ptr;              /**< Cache-line aligned start */
+    u32   size;             /**< Usable size, rounded up to whole cache lines */
+    int   cacheable;
+} HazeDmaBuffer;
+
+//==========================================================================================
+// POOL MANAGEMENT
+//==========================================================================================
+
+/**
+ * @brief Initialise a pool over caller-provided static memory
+ * @param cacheable 0 remaps every 1 MB section of the pool as normal non-cacheable memory;
+ *                  base and size must then be section aligned
+ * @return XST_SUCCESS, or XST_FAILURE on misalignment
+ */
+static inline int haze_dma_pool_init(HazeDmaPool *pool, void *base, u32 size, int cacheable) {
+    UINTPTR addr = (UINTPTR)base;
+
+    if (addr % HAZE_DMA_CACHE_LINE)
+        return XST_FAILURE;
+
+    if (!cacheable) {
+        if ((addr % HAZE_DMA_SECTION_SIZE) || (size % HAZE_DMA_SECTION_SIZE))
+            return XST_FAILURE;
+
+        // Write back and drop any lines still cached for the region before remapping
+        Xil_DCacheFlushRange(addr, size);
+        for (u32 off = 0; off < size; off += HAZE_DMA_SECTION_SIZE)
+            Xil_SetTlbAttributes(addr + off, NORM_NONCACHE);
+        dsb();
+    }
+
+    pool->base = (u8 *)base;
+    pool->size = size;
+    pool->used = 0;
+    pool->cacheable = cacheable;
+    return XST_SUCCESS;
+}
+
+/**
+ * @brief Allocate a cache-line-aligned buffer of at least bytes from the pool
+ * Sizes are rounded to whole lines so range invalidation never touches a neighbour.
+ */
+static inline int haze_dma_alloc(HazeDmaPool *pool, u32 bytes, HazeDmaBuffer *buf) {
+    u32 size = HAZE_DMA_ALIGN_UP(bytes, HAZE_DMA_CACHE_LINE);
+
+    if (size > pool->size - pool->used)
+        return XST_FAILURE;
+
+    buf->ptr = pool->base + pool->used;
+    buf->size = size;
+    buf->cacheable = pool->cacheable;
+    pool->used += size;
+    return XST_SUCCESS;
+}
+
+//==========================================================================================
+// CACHE MAINTENANCE
+//==========================================================================================
+
+/**
+ * @brief MM2S: make CPU writes to the first bytes of buf visible to the DMA engine
+ */
+static inline void haze_dma_sync_for_device(const HazeDmaBuffer *buf, u32 bytes) {
+    if (buf->cacheable)
+        Xil_DCacheFlushRange((UINTPTR)buf->ptr, HAZE_DMA_ALIGN_UP(bytes, HAZE_DMA_CACHE_LINE));
+    else
+        dsb();      // Drain the write buffer
+}
+
+/**
+ * @brief S2MM, before the transfer: discard cached lines of the destination range
+ */
+static inline void haze_dma_sync_for_receive(const HazeDmaBuffer *buf, u32 bytes) {
+    if (buf->cacheable)
+        Xil_DCacheInvalidateRange((UINTPTR)buf->ptr, HAZE_DMA_ALIGN_UP(bytes, HAZE_DMA_CACHE_LINE));
+}
+
+/**
+ * @brief S2MM, after completion: drop lines speculatively fetched during the transfer
+ */
+static inline void haze_dma_sync_for_cpu(const HazeDmaBuffer *buf, u32 bytes) {
+    if (buf->cacheable)
+        Xil_DCacheInvalidateRange((UINTPTR)buf->ptr, HAZE_DMA_ALIGN_UP(bytes, HAZE_DMA_CACHE_LINE));
+    else
+        dmb();
+}
+
+#endif // HAZEREMOVAL_DMABUFFER_H
@@ -0,0 +1,390 @@
+/**
+ * @file HazeRemoval_Encoder.h
+ * @brief Lossless output encoder fused after saturation correction
+ * @description Compresses the packed RGB24 output band by band as the pipeline produces
+ *              it, so frames leave the system at a fraction of their raw 768 KB. The
+ *              codec is QOI ("Quite OK Image", qoiformat.org): a single pass over the
+ *              pixels with run-length, 64-entry colour cache and small-delta opcodes,
+ *              typically within 10-20% of PNG on natural images at many times the speed.
+ *              Each frame is a complete .qoi image (3 channels, sRGB).
+ *
+ *              The producer announces finished rows with haze_encoder_publish(); codec
+ *              state carries across bands, so the stream is identical to encoding the
+ *              whole frame at once.
+ *
+ * @author Rohan M
+ * @date 18th October 2026
+ * @version 1.0
+ *
+ * Backends:
+ * - Bare-metal (default): bands are encoded in the caller's context on publish.
+ * - HOST_BUILD: bands are encoded on a worker thread, overlapping the processing of
+ *   the next band; haze_encoder_finish() waits for the tail.
+ *
+ * Configuration:
+ * - HAZE_ENC_BAND_ROWS   Rows handed to the encoder at a time (default: 32)
+ *
+ * Requires u8, u32, XTime, XTime_GetTime() and COUNTS_PER_SECOND to be defined before
+ * inclusion.
+ */
+#ifndef HAZEREMOVAL_ENCODER_H
+#define HAZEREMOVAL_ENCODER_H
+
+#include <stdlib.h>
+#include <string.h>
+#ifdef HOST_BUILD
+#include <pthread.h>
+#endif
+
+//==========================================================================================
+// CONFIGURATION
+//==========================================================================================
+#ifndef HAZE_ENC_BAND_ROWS
+#define HAZE_ENC_BAND_ROWS       32
+#endif
+
+#define HAZE_QOI_HEADER_SIZE     14
+#define HAZE_QOI_END_SIZE        8
+#define HAZE_QOI_MAX_RUN         62
+/** Worst case: every pixel a full QOI_OP_RGBA-sized op, plus header and end marker */
+#define HAZE_QOI_MAX_BYTES(w, h) ((u32)(w) * (u32)(h) * 4 + HAZE_QOI_HEADER_SIZE + HAZE_QOI_END_SIZE)
+
+#define HAZE_QOI_OP_INDEX        0x00
+#define HAZE_QOI_OP_DIFF         0x40
+#define HAZE_QOI_OP_LUMA         0x80
+#define HAZE_QOI_OP_RUN          0xC0
+#define HAZE_QOI_OP_RGB          0xFE
+
+//==========================================================================================
+// TYPE DEFINITIONS
+//==========================================================================================
+typedef struct {
+    int  width, height;
+    u8  *buf;                           /**< Encoded frame */
+    u32  capacity;
+    u32  size;                          /**< Bytes of buf in use */
+
+    // Codec state, carried across bands
+    const u8 *src;                      /**< Interleaved RGB frame being encoded */
+    u32  index[64];                     /**< Colour cache, 0xAABBGGRR (A = 255 once set) */
+    u32  prev;
+    int  run;
+
+    // Band hand-off: rows [0, rows_ready) are final, [0, rows_done) are encoded
+    int  rows_ready;
+    int  rows_done;
+
+    // Totals for haze_encoder_report()
+    double raw_bytes, enc_bytes;        /**< Over all frames, including repeats */
+    double enc_pixels;                  /**< Pixels actually run through the codec */
+    XTime  enc_ticks;                   /**< Time spent encoding them */
+    u32    frames;
+
+#ifdef HOST_BUILD
+    int             running;
+    pthread_t       worker;
+    pthread_mutex_t lock;
+    pthread_cond_t  work;               /**< Signals the worker: rows published or stop */
+    pthread_cond_t  done;               /**< Signals finish: rows encoded */
+#endif
+} HazeEncoder;
+
+//==========================================================================================
+// QOI CODEC
+//==========================================================================================
+
+static inline void haze_qoi_put_u32(u8 *p, u32 v) {
+    p[0] = (u8)(v >> 24);
+    p[1] = (u8)(v >> 16);
+    p[2] = (u8)(v >> 8);
+    p[3] = (u8)v;
+}
+
+/**
+ * @brief Start a frame: reset the codec state and write the QOI header
+ */
+static inline void haze_qoi_begin(HazeEncoder *e, const u8 *rgb) {
+    u8 *p = e->buf;
+
+    memcpy(p, "qoif", 4);
+    haze_qoi_put_u32(p + 4, (u32)e->width);
+    haze_qoi_put_u32(p + 8, (u32)e->height);
+    p[12] = 3;                          // Channels: RGB
+    p[13] = 0;                          // Colour space: sRGB with linear alpha
+    e->size = HAZE_QOI_HEADER_SIZE;
+
+    e->src = rgb;
+    memset(e->index, 0, sizeof(e->index));
+    e->prev = 0xFF000000u;              // r = g = b = 0, a = 255
+    e->run = 0;
+}
+
+/**
+ * @brief Encode rows [r0, r1) of the current frame
+ */
+static inline void haze_qoi_encode_rows(HazeEncoder *e, int r0, int r1) {
+    const u8 *px = e->src + (size_t)r0 * e->width * 3;
+    const u8 *end = e->src + (size_t)r1 * e->width * 3;
+    u8 *out = e->buf + e->size;
+    u32 prev = e->prev;
+    int run = e->run;
+
+    for (; px < end; px += 3) {
+        u32 cur = 0xFF000000u | ((u32)px[2] << 16) | ((u32)px[1] << 8) | px[0];
+
+        if (cur == prev) {
+            if (++run == HAZE_QOI_MAX_RUN) {
+                *out++ = (u8)(HAZE_QOI_OP_RUN | (run - 1));
+                run = 0;
+            }
+            continue;
+        }
+        if (run) {
+            *out++ = (u8)(HAZE_QOI_OP_RUN | (run - 1));
+            run = 0;
+        }
+
+        int h = (px[0] * 3 + px[1] * 5 + px[2] * 7 + 255 * 11) & 63;
+        if (e->index[h] == cur) {
+            *out++ = (u8)(HAZE_QOI_OP_INDEX | h);
+        } else {
+            e->index[h] = cur;
+
+            // Channel deltas wrap modulo 256
+            int dr = (signed char)(px[0] - (u8)prev);
+            int dg = (signed char)(px[1] - (u8)(prev >> 8));
+            int db = (signed char)(px[2] - (u8)(prev >> 16));
+            int dr_dg = dr - dg, db_dg = db - dg;
+
+            if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+                *out++ = (u8)(HAZE_QOI_OP_DIFF | ((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2));
+            } else if (dg >= -32 && dg <= 31 && dr_dg >= -8 && dr_dg <= 7 &&
+                       db_dg >= -8 && db_dg <= 7) {
+                *out++ = (u8)(HAZE_QOI_OP_LUMA | (dg + 32));
+                *out++ = (u8)(((dr_dg + 8) << 4) | (db_dg + 8));
+            } else {
+                *out++ = HAZE_QOI_OP_RGB;
+                *out++ = px[0];
+                *out++ = px[1];
+                *out++ = px[2];
+            }
+        }
+        prev = cur;
+    }
+
+    e->prev = prev;
+    e->run = run;
+    e->size = (u32)(out - e->buf);
+}
+
+/**
+ * @brief Flush a pending run and write the end marker (7 x 0x00, 0x01)
+ */
+static inline void haze_qoi_end(HazeEncoder *e) {
+    u8 *out = e->buf + e->size;
+
+    if (e->run) {
+        *out++ = (u8)(HAZE_QOI_OP_RUN | (e->run - 1));
+        e->run = 0;
+    }
+    memset(out, 0, HAZE_QOI_END_SIZE - 1);
+    out[HAZE_QOI_END_SIZE - 1] = 0x01;
+    e->size = (u32)(out + HAZE_QOI_END_SIZE - e->buf);
+}
+
+/**
+ * @brief Encode rows [r0, r1) and account the time taken
+ */
+static inline void haze_encoder_run(HazeEncoder *e, int r0, int r1) {
+    XTime t_start, t_end;
+
+    XTime_GetTime(&t_start);
+    haze_qoi_encode_rows(e, r0, r1);
+    XTime_GetTime(&t_end);
+    e->enc_ticks += t_end - t_start;
+    e->enc_pixels += (double)(r1 - r0) * e->width;
+}
+
+#ifdef HOST_BUILD
+//==========================================================================================
+// HOST BACKEND (worker thread)
+//==========================================================================================
+
+static void *haze_encoder_worker(void *arg) {
+    HazeEncoder *e = (HazeEncoder *)arg;
+
+    pthread_mutex_lock(&e->lock);
+    while (e->running) {
+        if (e->rows_done == e->rows_ready) {
+            pthread_cond_wait(&e->work, &e->lock);
+            continue;
+        }
+        int r0 = e->rows_done, r1 = e->rows_ready;
+
+        // Rows below rows_ready are final, so they are encoded unlocked
+        pthread_mutex_unlock(&e->lock);
+        haze_encoder_run(e, r0, r1);
+        pthread_mutex_lock(&e->lock);
+
+        e->rows_done = r1;
+        pthread_cond_signal(&e->done);
+    }
+    pthread_mutex_unlock(&e->lock);
+    return NULL;
+}
+
+static inline int haze_encoder_start(HazeEncoder *e) {
+    pthread_mutex_init(&e->lock, NULL);
+    pthread_cond_init(&e->work, NULL);
+    pthread_cond_init(&e->done, NULL);
+    e->running = 1;
+    if (pthread_create(&e->worker, NULL, haze_encoder_worker, e) != 0) {
+        e->running = 0;
+        pthread_mutex_destroy(&e->lock);
+        pthread_cond_destroy(&e->work);
+        pthread_cond_destroy(&e->done);
+        return -1;
+    }
+    return 0;
+}
+
+static inline void haze_encoder_stop(HazeEncoder *e) {
+    if (!e->running)
+        return;
+    pthread_mutex_lock(&e->lock);
+    e->running = 0;
+    pthread_cond_signal(&e->work);
+    pthread_mutex_unlock(&e->lock);
+    pthread_join(e->worker, NULL);
+    pthread_mutex_destroy(&e->lock);
+    pthread_cond_destroy(&e->work);
+    pthread_cond_destroy(&e->done);
+}
+
+static inline void haze_encoder_reset(HazeEncoder *e) {
+    pthread_mutex_lock(&e->lock);
+    e->rows_ready = 0;
+    e->rows_done = 0;
+    pthread_mutex_unlock(&e->lock);
+}
+
+/**
+ * @brief Declare rows [0, rows) of the frame final and wake the worker
+ */
+static inline void haze_encoder_publish(HazeEncoder *e, int rows) {
+    pthread_mutex_lock(&e->lock);
+    e->rows_ready = rows;
+    pthread_cond_signal(&e->work);
+    pthread_mutex_unlock(&e->lock);
+}
+
+static inline void haze_encoder_wait(HazeEncoder *e) {
+    pthread_mutex_lock(&e->lock);
+    while (e->rows_done < e->height)
+        pthread_cond_wait(&e->done, &e->lock);
+    pthread_mutex_unlock(&e->lock);
+}
+
+#else
+//==========================================================================================
+// BARE-METAL BACKEND (inline)
+//==========================================================================================
+
+static inline int haze_encoder_start(HazeEncoder *e) {
+    (void)e;
+    return 0;
+}
+
+static inline void haze_encoder_stop(HazeEncoder *e) {
+    (void)e;
+}
+
+static inline void haze_encoder_reset(HazeEncoder *e) {
+    e->rows_ready = 0;
+    e->rows_done = 0;
+}
+
+static inline void haze_encoder_publish(HazeEncoder *e, int rows) {
+    e->rows_ready = rows;
+    haze_encoder_run(e, e->rows_done, rows);
+    e->rows_done = rows;
+}
+
+static inline void haze_encoder_wait(HazeEncoder *e) {
+    (void)e;
+}
+#endif // HOST_BUILD
+
+//==========================================================================================
+// API
+//==========================================================================================
+
+/**
+ * @brief Allocate the worst-case output buffer and start the backend
+ * @return 0 on success, -1 on failure (nothing left allocated)
+ */
+static inline int haze_encoder_init(HazeEncoder *e, int width, int height) {
+    memset(e, 0, sizeof(*e));
+    e->width = width;
+    e->height = height;
+    e->capacity = HAZE_QOI_MAX_BYTES(width, height);
+    e->buf = (u8*)malloc(e->capacity);
+    if (!e->buf)
+        return -1;
+    if (haze_encoder_start(e) != 0) {
+        free(e->buf);
+        e->buf = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+static inline void haze_encoder_close(HazeEncoder *e) {
+    haze_encoder_stop(e);
+    free(e->buf);
+    memset(e, 0, sizeof(*e));
+}
+
+/**
+ * @brief Start encoding a frame; rgb must stay valid until haze_encoder_finish()
+ * The previous frame must have been finished.
+ */
+static inline void haze_encoder_begin(HazeEncoder *e, const u8 *rgb) {
+    haze_qoi_begin(e, rgb);
+    haze_encoder_reset(e);
+}
+
+/**
+ * @brief Wait for the last band and close the frame
+ * @return Encoded size in bytes; the frame is e->buf[0, size)
+ */
+static inline u32 haze_encoder_finish(HazeEncoder *e) {
+    haze_encoder_wait(e);
+    haze_qoi_end(e);
+    e->raw_bytes += (double)e->width * e->height * 3;
+    e->enc_bytes += e->size;
+    e->frames++;
+    return e->size;
+}
+
+/**
+ * @brief Account a frame whose output equals the previous one, leaving buf as it is
+ */
+static inline u32 haze_encoder_repeat(HazeEncoder *e) {
+    e->raw_bytes += (double)e->width * e->height * 3;
+    e->enc_bytes += e->size;
+    e->frames++;
+    return e->size;
+}
+
+/**
+ * @brief Compression ratio (raw / encoded) and encoder throughput over all frames
+ */
+static inline void haze_encoder_report(const HazeEncoder *e, double *ratio, double *mpix_s) {
+    double secs = (double)e->enc_ticks / (double)COUNTS_PER_SECOND;
+
+    *ratio = (e->enc_bytes > 0.0) ? e->raw_bytes / e->enc_bytes : 0.0;
+    *mpix_s = (secs > 0.0) ? e->enc_pixels / 1000000.0 / secs : 0.0;
+}
+
+#endif // HAZEREMOVAL_ENCODER_H
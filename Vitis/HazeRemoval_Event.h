@@ -0,0 +1,213 @@
+/**
+ * @file HazeRemoval_Event.h
+ * @brief Event-driven completion signalling between interrupt handlers and main code
+ * @description Replaces busy-spinning on completion flags. Interrupt handlers (or the
+ *              simulated device thread on the host) call haze_event_post(); consumers
+ *              block in haze_event_wait() until one of the requested events arrives.
+ *              Callbacks registered with haze_event_register() never run in interrupt
+ *              context: on the host they run on a dedicated worker thread, on the board
+ *              they are dispatched from haze_event_wait() in thread context.
+ *
+ * @author Rohan M
+ * @date 18th October 2026
+ * @version 1.0
+ *
+ * Backends:
+ * - Bare-metal (default): volatile event mask with DMB ordering; the waiter masks IRQs,
+ *   re-checks the mask and sleeps with WFI so no event can be lost between the check
+ *   and the sleep. A pending IRQ wakes WFI even while masked.
+ * - HOST_BUILD: pthread mutex + condition variables and one callback worker thread.
+ *
+ * Requires u32 to be defined before inclusion.
+ */
+#ifndef HAZEREMOVAL_EVENT_H
+#define HAZEREMOVAL_EVENT_H
+
+//==========================================================================================
+// EVENTS
+//==========================================================================================
+#define HAZE_EVENT_DMA_DONE      (1u << 0)  /**< S2MM transfer complete (frame processed) */
+#define HAZE_EVENT_UART_DONE     (1u << 1)  /**< UART transmit buffer drained */
+#define HAZE_EVENT_FRAME_READY   (1u << 2)  /**< Input frame available for processing */
+#define HAZE_EVENT_SHUTDOWN      (1u << 3)  /**< Stop the (simulated) device */
+#define HAZE_EVENT_MAX           8          /**< Maximum registered callbacks */
+
+typedef void (*HazeEvent_Callback)(u32 events, void *ref);
+
+typedef struct {
+    u32 mask;
+    HazeEvent_Callback fn;
+    void *ref;
+} HazeEvent_Handler;
+
+#ifdef HOST_BUILD
+//==========================================================================================
+// HOST BACKEND (pthreads)
+//==========================================================================================
+#include <pthread.h>
+
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t  posted;             // Signals the callback worker
+    pthread_cond_t  ready;              // Signals waiters
+    pthread_t       worker;
+    u32             pending;            // Posted, callbacks not yet run
+    u32             ready_mask;         // Deliverable to haze_event_wait()
+    int             running;
+    HazeEvent_Handler handlers[HAZE_EVENT_MAX];
+    int             num_handlers;
+} HazeEvent;
+
+static void *haze_event_worker(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&HazeEvent.lock);
+    while (HazeEvent.running) {
+        if (!HazeEvent.pending) {
+            pthread_cond_wait(&HazeEvent.posted, &HazeEvent.lock);
+            continue;
+        }
+        u32 ev = HazeEvent.pending;
+        HazeEvent.pending = 0;
+
+        // Callbacks run unlocked so they may post further events
+        pthread_mutex_unlock(&HazeEvent.lock);
+        for (int i = 0; i < HazeEvent.num_handlers; i++) {
+            if (ev & HazeEvent.handlers[i].mask)
+                HazeEvent.handlers[i].fn(ev & HazeEvent.handlers[i].mask, HazeEvent.handlers[i].ref);
+        }
+        pthread_mutex_lock(&HazeEvent.lock);
+
+        HazeEvent.ready_mask |= ev;
+        pthread_cond_broadcast(&HazeEvent.ready);
+    }
+    pthread_mutex_unlock(&HazeEvent.lock);
+    return NULL;
+}
+
+static inline int haze_event_init(void) {
+    pthread_mutex_init(&HazeEvent.lock, NULL);
+    pthread_cond_init(&HazeEvent.posted, NULL);
+    pthread_cond_init(&HazeEvent.ready, NULL);
+    HazeEvent.pending = 0;
+    HazeEvent.ready_mask = 0;
+    HazeEvent.num_handlers = 0;
+    HazeEvent.running = 1;
+    return pthread_create(&HazeEvent.worker, NULL, haze_event_worker, NULL) == 0 ? 0 : -1;
+}
+
+static inline void haze_event_shutdown(void) {
+    pthread_mutex_lock(&HazeEvent.lock);
+    HazeEvent.running = 0;
+    pthread_cond_signal(&HazeEvent.posted);
+    pthread_mutex_unlock(&HazeEvent.lock);
+    pthread_join(HazeEvent.worker, NULL);
+}
+
+/**
+ * @brief Register a callback for events in mask (call before any event is posted)
+ */
+static inline int haze_event_register(u32 mask, HazeEvent_Callback fn, void *ref) {
+    if (HazeEvent.num_handlers >= HAZE_EVENT_MAX)
+        return -1;
+    HazeEvent.handlers[HazeEvent.num_handlers].mask = mask;
+    HazeEvent.handlers[HazeEvent.num_handlers].fn = fn;
+    HazeEvent.handlers[HazeEvent.num_handlers].ref = ref;
+    HazeEvent.num_handlers++;
+    return 0;
+}
+
+/**
+ * @brief Signal events (producer / device side)
+ */
+static inline void haze_event_post(u32 events) {
+    pthread_mutex_lock(&HazeEvent.lock);
+    HazeEvent.pending |= events;
+    pthread_cond_signal(&HazeEvent.posted);
+    pthread_mutex_unlock(&HazeEvent.lock);
+}
+
+/**
+ * @brief Block until any event in mask has been delivered; consumes and returns them
+ */
+static inline u32 haze_event_wait(u32 mask) {
+    u32 ev;
+    pthread_mutex_lock(&HazeEvent.lock);
+    while (!(HazeEvent.ready_mask & mask))
+        pthread_cond_wait(&HazeEvent.ready, &HazeEvent.lock);
+    ev = HazeEvent.ready_mask & mask;
+    HazeEvent.ready_mask &= ~ev;
+    pthread_mutex_unlock(&HazeEvent.lock);
+    return ev;
+}
+
+#else
+//==========================================================================================
+// BARE-METAL BACKEND (Cortex-A9, interrupts + WFI)
+//==========================================================================================
+#include "xil_exception.h"
+#include "xpseudo_asm.h"
+
+static volatile u32 HazeEventPending;       /**< Written by ISRs, consumed by waiters */
+static HazeEvent_Handler HazeEventHandlers[HAZE_EVENT_MAX];
+static int HazeEventNumHandlers;
+
+static inline int haze_event_init(void) {
+    HazeEventPending = 0;
+    HazeEventNumHandlers = 0;
+    return 0;
+}
+
+static inline void haze_event_shutdown(void) {
+}
+
+static inline int haze_event_register(u32 mask, HazeEvent_Callback fn, void *ref) {
+    if (HazeEventNumHandlers >= HAZE_EVENT_MAX)
+        return -1;
+    HazeEventHandlers[HazeEventNumHandlers].mask = mask;
+    HazeEventHandlers[HazeEventNumHandlers].fn = fn;
+    HazeEventHandlers[HazeEventNumHandlers].ref = ref;
+    HazeEventNumHandlers++;
+    return 0;
+}
+
+/**
+ * @brief Signal events from an ISR
+ * The barrier orders all prior writes (DMA bookkeeping, timestamps) before the flag.
+ */
+static inline void haze_event_post(u32 events) {
+    dmb();
+    HazeEventPending |= events;
+    dsb();
+}
+
+/**
+ * @brief Sleep in WFI until any event in mask is posted; consumes and returns them
+ * Registered callbacks for the returned events run here, in thread context.
+ */
+static inline u32 haze_event_wait(u32 mask) {
+    u32 ev;
+
+    Xil_ExceptionDisable();
+    while (!(HazeEventPending & mask)) {
+        // A pending IRQ wakes WFI even while masked; unmask to let the ISR run
+        wfi();
+        Xil_ExceptionEnable();
+        Xil_ExceptionDisable();
+    }
+    ev = HazeEventPending & mask;
+    HazeEventPending &= ~ev;
+    Xil_ExceptionEnable();
+
+    // Observe everything the ISR wrote before posting
+    dmb();
+
+    for (int i = 0; i < HazeEventNumHandlers; i++) {
+        if (ev & HazeEventHandlers[i].mask)
+            HazeEventHandlers[i].fn(ev & HazeEventHandlers[i].mask, HazeEventHandlers[i].ref);
+    }
+    return ev;
+}
+
+#endif // HOST_BUILD
+
+#endif // HAZEREMOVAL_EVENT_H
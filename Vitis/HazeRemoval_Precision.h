@@ -0,0 +1,380 @@
+/**
+ * @file HazeRemoval_Precision.h
+ * @brief Precision tiers for the transmission and scene recovery stages
+ * @description Row kernels that store the transmission map and recover the scene
+ *              radiance at a selectable precision, so accuracy can be traded for
+ *              memory traffic and throughput per deployment:
+ *              - fp32   32-bit float transmission, float arithmetic (reference)
+ *              - fp16   IEEE half transmission storage, float arithmetic; F16C on x86,
+ *                       NEON half conversions on ARM (-mfp16-format=ieee), else scalar
+ *              - fixed  The RTL datapath of TE_and_SRSC.v: transmission in Q0.10, its
+ *                       reciprocal in Q2.6 (Transmission_Reciprocal_LUT) and an 8-bit
+ *                       saturating |Ic - Ac| * (1/t) (Multiplier_SRSC, Adder_SRSC)
+ *              Every tier has a NEON, an SSE2/F16C and a scalar implementation.
+ *
+ * @author Rohan M
+ * @date 18th October 2026
+ * @version 1.0
+ *
+ * Requires u8, u16 and u32 to be defined before inclusion.
+ */
+#ifndef HAZEREMOVAL_PRECISION_H
+#define HAZEREMOVAL_PRECISION_H
+
+#include <string.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define HAZE_PREC_NEON           1
+#if defined(__ARM_FP16_FORMAT_IEEE)
+#define HAZE_PREC_NEON_FP16      1
+#endif
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define HAZE_PREC_SSE2           1
+#if defined(__F16C__)
+#include <immintrin.h>
+#define HAZE_PREC_F16C           1
+#endif
+#endif
+
+//==========================================================================================
+// CONFIGURATION
+//==========================================================================================
+#define Q_T_FRAC                 10         /**< Transmission in Q0.10 */
+#define Q_T_ONE                  (1 << Q_T_FRAC)
+#define Q_RECIP_FRAC             6          /**< Transmission reciprocal in Q2.6 */
+
+typedef enum {
+    HAZE_PREC_FP32 = 0,
+    HAZE_PREC_FP16,
+    HAZE_PREC_FIXED,
+    HAZE_PREC_COUNT
+} HazePrecision;
+
+static const char *const HazePrecisionNames[HAZE_PREC_COUNT] = { "fp32", "fp16", "fixed" };
+
+static inline int haze_precision_parse(const char *name, HazePrecision *prec) {
+    for (int k = 0; k < HAZE_PREC_COUNT; k++) {
+        if (strcmp(name, HazePrecisionNames[k]) == 0) {
+            *prec = (HazePrecision)k;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Accuracy of a tier against fp32, accumulated over frames
+ */
+typedef struct {
+    double t_max_err;                   /**< Largest |t - t_fp32| */
+    double out_sq_err;                  /**< Sum of squared output byte errors */
+    u32    out_max_diff;                /**< Largest output byte error */
+    double out_bytes;                   /**< Output bytes compared, summed over frames */
+    u32    frames;
+} HazePrecisionError;
+
+//==========================================================================================
+// SCALAR HELPERS
+//==========================================================================================
+
+/**
+ * @brief float -> IEEE half, round to nearest even (normals, subnormals, inf, nan)
+ */
+static inline u16 haze_f32_to_f16(float f) {
+    u32 x;
+    memcpy(&x, &f, sizeof(x));
+    u32 sign = (x >> 16) & 0x8000u;
+    int exp = (int)((x >> 23) & 0xFF) - 127 + 15;
+    u32 mant = x & 0x7FFFFFu;
+
+    if (((x >> 23) & 0xFF) == 0xFF)
+        return (u16)(sign | 0x7C00u | (mant ? 0x200u : 0));
+    if (exp >= 31)
+        return (u16)(sign | 0x7C00u);
+    if (exp <= 0) {
+        if (exp < -10)
+            return (u16)sign;
+        mant |= 0x800000u;
+        u32 shift = (u32)(14 - exp);
+        u32 half = mant >> shift;
+        u32 rem = mant & ((1u << shift) - 1);
+        u32 mid = 1u << (shift - 1);
+        if (rem > mid || (rem == mid && (half & 1)))
+            half++;
+        return (u16)(sign | half);
+    }
+
+    u32 half = sign | ((u32)exp << 10) | (mant >> 13);
+    u32 rem = mant & 0x1FFFu;
+    if (rem > 0x1000u || (rem == 0x1000u && (half & 1)))
+        half++;                         // May carry into the exponent, which is correct
+    return (u16)half;
+}
+
+static inline float haze_f16_to_f32(u16 h) {
+    u32 sign = ((u32)h & 0x8000u) << 16;
+    u32 exp = (h >> 10) & 0x1F;
+    u32 mant = h & 0x3FFu;
+    u32 x;
+    float f;
+
+    if (exp == 0x1F) {
+        x = sign | 0x7F800000u | (mant << 13);
+    } else if (exp == 0) {
+        if (mant == 0) {
+            x = sign;
+        } else {
+            // Subnormal: renormalise
+            exp = 127 - 15 + 1;
+            while (!(mant & 0x400u)) {
+                mant <<= 1;
+                exp--;
+            }
+            x = sign | (exp << 23) | ((mant & 0x3FFu) << 13);
+        }
+    } else {
+        x = sign | ((exp + 127 - 15) << 23) | (mant << 13);
+    }
+    memcpy(&f, &x, sizeof(f));
+    return f;
+}
+
+static inline float haze_prec_clamp01(float v) {
+    return (v < 0.0f) ? 0.0f : ((v > 1.0f) ? 1.0f : v);
+}
+
+static inline u8 haze_prec_sat_u8(int v) {
+    return (u8)((v < 0) ? 0 : ((v > 255) ? 255 : v));
+}
+
+//==========================================================================================
+// TRANSMISSION STORE: t = clamp(1 - omega * ratio, 0, 1)
+//==========================================================================================
+
+static inline void te_store_fp32(const float *ratio, float omega, float *t, int n) {
+    int k = 0;
+#if defined(HAZE_PREC_NEON)
+    float32x4_t one = vdupq_n_f32(1.0f), zero = vdupq_n_f32(0.0f);
+    for (; k + 4 <= n; k += 4) {
+        float32x4_t v = vmlsq_n_f32(one, vld1q_f32(ratio + k), omega);
+        vst1q_f32(t + k, vminq_f32(vmaxq_f32(v, zero), one));
+    }
+#elif defined(HAZE_PREC_SSE2)
+    __m128 one = _mm_set1_ps(1.0f), zero = _mm_setzero_ps(), w = _mm_set1_ps(omega);
+    for (; k + 4 <= n; k += 4) {
+        __m128 v = _mm_sub_ps(one, _mm_mul_ps(w, _mm_loadu_ps(ratio + k)));
+        _mm_storeu_ps(t + k, _mm_min_ps(_mm_max_ps(v, zero), one));
+    }
+#endif
+    for (; k < n; k++)
+        t[k] = haze_prec_clamp01(1.0f - omega * ratio[k]);
+}
+
+static inline void te_store_fp16(const float *ratio, float omega, u16 *t, int n) {
+    int k = 0;
+#if defined(HAZE_PREC_NEON_FP16)
+    float32x4_t one = vdupq_n_f32(1.0f), zero = vdupq_n_f32(0.0f);
+    for (; k + 4 <= n; k += 4) {
+        float32x4_t v = vmlsq_n_f32(one, vld1q_f32(ratio + k), omega);
+        v = vminq_f32(vmaxq_f32(v, zero), one);
+        vst1_u16(t + k, vreinterpret_u16_f16(vcvt_f16_f32(v)));
+    }
+#elif defined(HAZE_PREC_F16C)
+    __m128 one = _mm_set1_ps(1.0f), zero = _mm_setzero_ps(), w = _mm_set1_ps(omega);
+    for (; k + 4 <= n; k += 4) {
+        __m128 v = _mm_sub_ps(one, _mm_mul_ps(w, _mm_loadu_ps(ratio + k)));
+        v = _mm_min_ps(_mm_max_ps(v, zero), one);
+        _mm_storel_epi64((__m128i *)(t + k), _mm_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT));
+    }
+#endif
+    for (; k < n; k++)
+        t[k] = haze_f32_to_f16(haze_prec_clamp01(1.0f - omega * ratio[k]));
+}
+
+static inline void te_store_fixed(const float *ratio, float omega, u16 *t, int n) {
+    int k = 0;
+#if defined(HAZE_PREC_NEON)
+    float32x4_t one = vdupq_n_f32(1.0f), zero = vdupq_n_f32(0.0f), half = vdupq_n_f32(0.5f);
+    for (; k + 4 <= n; k += 4) {
+        float32x4_t v = vmlsq_n_f32(one, vld1q_f32(ratio + k), omega);
+        v = vmlaq_n_f32(half, vminq_f32(vmaxq_f32(v, zero), one), (float)Q_T_ONE);
+        vst1_u16(t + k, vmovn_u32(vcvtq_u32_f32(v)));
+    }
+#elif defined(HAZE_PREC_SSE2)
+    __m128 one = _mm_set1_ps(1.0f), zero = _mm_setzero_ps(), w = _mm_set1_ps(omega);
+    __m128 scale = _mm_set1_ps((float)Q_T_ONE), half = _mm_set1_ps(0.5f);
+    for (; k + 4 <= n; k += 4) {
+        __m128 v = _mm_sub_ps(one, _mm_mul_ps(w, _mm_loadu_ps(ratio + k)));
+        v = _mm_add_ps(_mm_mul_ps(_mm_min_ps(_mm_max_ps(v, zero), one), scale), half);
+        __m128i q = _mm_cvttps_epi32(v);            // 0..1024, fits a signed pack
+        _mm_storel_epi64((__m128i *)(t + k), _mm_packs_epi32(q, q));
+    }
+#endif
+    for (; k < n; k++)
+        t[k] = (u16)(haze_prec_clamp01(1.0f - omega * ratio[k]) * Q_T_ONE + 0.5f);
+}
+
+//==========================================================================================
+// SCENE RECOVERY: J_c = (I_c - A_c) / max(t, t0) + A_c
+//==========================================================================================
+
+#if defined(HAZE_PREC_NEON)
+/**
+ * @brief NEON has no vector divide on ARMv7: estimate plus two Newton-Raphson steps
+ */
+static inline float32x4_t haze_neon_recip(float32x4_t x) {
+    float32x4_t r = vrecpeq_f32(x);
+    r = vmulq_f32(r, vrecpsq_f32(x, r));
+    r = vmulq_f32(r, vrecpsq_f32(x, r));
+    return r;
+}
+
+static inline void sr_neon_4(float32x4_t tv, float t0, const float *i_r, const float *i_g,
+                             const float *i_b, float ar, float ag, float ab,
+                             float *j_r, float *j_g, float *j_b) {
+    float32x4_t r = haze_neon_recip(vmaxq_f32(tv, vdupq_n_f32(t0)));
+    float32x4_t a;
+    a = vdupq_n_f32(ar);
+    vst1q_f32(j_r, vmlaq_f32(a, vsubq_f32(vld1q_f32(i_r), a), r));
+    a = vdupq_n_f32(ag);
+    vst1q_f32(j_g, vmlaq_f32(a, vsubq_f32(vld1q_f32(i_g), a), r));
+    a = vdupq_n_f32(ab);
+    vst1q_f32(j_b, vmlaq_f32(a, vsubq_f32(vld1q_f32(i_b), a), r));
+}
+#elif defined(HAZE_PREC_SSE2)
+static inline void sr_sse_4(__m128 tv, float t0, const float *i_r, const float *i_g,
+                            const float *i_b, float ar, float ag, float ab,
+                            float *j_r, float *j_g, float *j_b) {
+    __m128 r = _mm_div_ps(_mm_set1_ps(1.0f), _mm_max_ps(tv, _mm_set1_ps(t0)));
+    __m128 a;
+    a = _mm_set1_ps(ar);
+    _mm_storeu_ps(j_r, _mm_add_ps(_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(i_r), a), r), a));
+    a = _mm_set1_ps(ag);
+    _mm_storeu_ps(j_g, _mm_add_ps(_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(i_g), a), r), a));
+    a = _mm_set1_ps(ab);
+    _mm_storeu_ps(j_b, _mm_add_ps(_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(i_b), a), r), a));
+}
+#endif
+
+static inline void sr_scalar_1(float t, float t0, const float *i_r, const float *i_g,
+                               const float *i_b, float ar, float ag, float ab,
+                               float *j_r, float *j_g, float *j_b) {
+    float r = 1.0f / ((t > t0) ? t : t0);
+    *j_r = (*i_r - ar) * r + ar;
+    *j_g = (*i_g - ag) * r + ag;
+    *j_b = (*i_b - ab) * r + ab;
+}
+
+static inline void sr_row_fp32(const float *t, float t0,
+                               const float *i_r, const float *i_g, const float *i_b,
+                               float ar, float ag, float ab,
+                               float *j_r, float *j_g, float *j_b, int n) {
+    int k = 0;
+#if defined(HAZE_PREC_NEON)
+    for (; k + 4 <= n; k += 4)
+        sr_neon_4(vld1q_f32(t + k), t0, i_r + k, i_g + k, i_b + k, ar, ag, ab,
+                  j_r + k, j_g + k, j_b + k);
+#elif defined(HAZE_PREC_SSE2)
+    for (; k + 4 <= n; k += 4)
+        sr_sse_4(_mm_loadu_ps(t + k), t0, i_r + k, i_g + k, i_b + k, ar, ag, ab,
+                 j_r + k, j_g + k, j_b + k);
+#endif
+    for (; k < n; k++)
+        sr_scalar_1(t[k], t0, i_r + k, i_g + k, i_b + k, ar, ag, ab, j_r + k, j_g + k, j_b + k);
+}
+
+static inline void sr_row_fp16(const u16 *t, float t0,
+                               const float *i_r, const float *i_g, const float *i_b,
+                               float ar, float ag, float ab,
+                               float *j_r, float *j_g, float *j_b, int n) {
+    int k = 0;
+#if defined(HAZE_PREC_NEON_FP16)
+    for (; k + 4 <= n; k += 4)
+        sr_neon_4(vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(t + k))), t0,
+                  i_r + k, i_g + k, i_b + k, ar, ag, ab, j_r + k, j_g + k, j_b + k);
+#elif defined(HAZE_PREC_F16C)
+    for (; k + 4 <= n; k += 4)
+        sr_sse_4(_mm_cvtph_ps(_mm_loadl_epi64((const __m128i *)(t + k))), t0,
+                 i_r + k, i_g + k, i_b + k, ar, ag, ab, j_r + k, j_g + k, j_b + k);
+#endif
+    for (; k < n; k++)
+        sr_scalar_1(haze_f16_to_f32(t[k]), t0, i_r + k, i_g + k, i_b + k, ar, ag, ab,
+                    j_r + k, j_g + k, j_b + k);
+}
+
+/**
+ * @brief Fixed-point scene recovery for one channel, as in Multiplier_SRSC / Adder_SRSC
+ * m = sat8(|I - A| * recip_Q2.6 >> 6); J = I > A ? sat8(A + m) : sat8(A - m)
+ */
+static inline float sr_fixed_1(u8 i, u8 a, u8 recip) {
+    int m = (((i > a) ? i - a : a - i) * recip) >> Q_RECIP_FRAC;
+    if (m > 255) m = 255;
+    return (float)haze_prec_sat_u8((i > a) ? a + m : a - m);
+}
+
+/**
+ * @brief Fixed-point tier: t in Q0.10, reciprocal from the Q2.6 table indexed by t
+ * Ac is taken as 8-bit, as on the hardware; J is written as float for the SC stage.
+ */
+static inline void sr_row_fixed(const u16 *t, const u8 *recip_q26,
+                                const u8 *i_r, const u8 *i_g, const u8 *i_b,
+                                u8 ar, u8 ag, u8 ab,
+                                float *j_r, float *j_g, float *j_b, int n) {
+    int k = 0;
+#if defined(HAZE_PREC_NEON)
+    const u8 *ip[3] = { i_r, i_g, i_b };
+    float *jp[3] = { j_r, j_g, j_b };
+    const u8 av[3] = { ar, ag, ab };
+    for (; k + 8 <= n; k += 8) {
+        u8 rc[8];
+        for (int m = 0; m < 8; m++)
+            rc[m] = recip_q26[t[k + m]];
+        uint8x8_t r = vld1_u8(rc);
+
+        for (int c = 0; c < 3; c++) {
+            uint8x8_t iv = vld1_u8(ip[c] + k);
+            uint8x8_t a = vdup_n_u8(av[c]);
+            uint8x8_t m = vqshrn_n_u16(vmull_u8(vabd_u8(iv, a), r), Q_RECIP_FRAC);
+            uint8x8_t j = vbsl_u8(vcgt_u8(iv, a), vqadd_u8(a, m), vqsub_u8(a, m));
+            uint16x8_t j16 = vmovl_u8(j);
+            vst1q_f32(jp[c] + k, vcvtq_f32_u32(vmovl_u16(vget_low_u16(j16))));
+            vst1q_f32(jp[c] + k + 4, vcvtq_f32_u32(vmovl_u16(vget_high_u16(j16))));
+        }
+    }
+#elif defined(HAZE_PREC_SSE2)
+    const u8 *ip[3] = { i_r, i_g, i_b };
+    float *jp[3] = { j_r, j_g, j_b };
+    const u8 av[3] = { ar, ag, ab };
+    __m128i zero = _mm_setzero_si128(), max8 = _mm_set1_epi16(255);
+    for (; k + 8 <= n; k += 8) {
+        __m128i r = _mm_setr_epi16(recip_q26[t[k]], recip_q26[t[k + 1]],
+                                   recip_q26[t[k + 2]], recip_q26[t[k + 3]],
+                                   recip_q26[t[k + 4]], recip_q26[t[k + 5]],
+                                   recip_q26[t[k + 6]], recip_q26[t[k + 7]]);
+
+        for (int c = 0; c < 3; c++) {
+            __m128i iv = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(ip[c] + k)), zero);
+            __m128i a = _mm_set1_epi16(av[c]);
+            __m128i d = _mm_sub_epi16(iv, a);
+            __m128i absd = _mm_max_epi16(d, _mm_sub_epi16(zero, d));
+            __m128i m = _mm_min_epi16(_mm_srli_epi16(_mm_mullo_epi16(absd, r), Q_RECIP_FRAC), max8);
+            __m128i gt = _mm_cmpgt_epi16(iv, a);
+            __m128i j = _mm_or_si128(_mm_and_si128(gt, _mm_add_epi16(a, m)),
+                                     _mm_andnot_si128(gt, _mm_sub_epi16(a, m)));
+            j = _mm_unpacklo_epi8(_mm_packus_epi16(j, j), zero);    // Saturate to 0..255
+            _mm_storeu_ps(jp[c] + k, _mm_cvtepi32_ps(_mm_unpacklo_epi16(j, zero)));
+            _mm_storeu_ps(jp[c] + k + 4, _mm_cvtepi32_ps(_mm_unpackhi_epi16(j, zero)));
+        }
+    }
+#endif
+    for (; k < n; k++) {
+        u8 rc = recip_q26[t[k]];
+        j_r[k] = sr_fixed_1(i_r[k], ar, rc);
+        j_g[k] = sr_fixed_1(i_g[k], ag, rc);
+        j_b[k] = sr_fixed_1(i_b[k], ab, rc);
+    }
+}
+
+#endif // HAZEREMOVAL_PRECISION_H
@@ -0,0 +1,257 @@
+/**
+ * @file HazeRemoval_Stats.h
+ * @brief Low-overhead hot-path counters for the haze removal engine and DMA driver
+ * @description Header-only statistics block shared by SW_Implementation_ARM.c and
+ *              Image_HazeRemoval_SW_Driver.c. Counters are updated through the STATS_*
+ *              macros and read back with haze_stats_get() or printed with
+ *              haze_stats_dump(). Build with -DHAZE_STATS_ENABLE to turn them on; without
+ *              it every macro expands to nothing and no storage is emitted.
+ *
+ * @author Rohan M
+ * @date 18th October 2026
+ * @version 1.0
+ *
+ * Configuration:
+ * - HAZE_STATS_ENABLE        Compile the counters in (default: off)
+ * - HAZE_STATS_DUMP_PERIOD   Print a dump every N frames, 0 = only on request (default: 0)
+ * - STATS_PRINTF             Output function used by haze_stats_dump() (default: printf)
+ *
+ * Requires u32 and XTime (xil_types.h / xtime_l.h, or the HOST_BUILD shims) to be
+ * defined before inclusion.
+ */
+#ifndef HAZEREMOVAL_STATS_H
+#define HAZEREMOVAL_STATS_H
+
+//==========================================================================================
+// CONFIGURATION
+//==========================================================================================
+#define STATS_AC_HISTORY         16         /**< Atmospheric light samples kept (ring buffer) */
+#define STATS_ED_CLASSES         3          /**< 0=smooth, 1=V/H edge, 2=diagonal edge */
+
+#ifndef HAZE_STATS_DUMP_PERIOD
+#define HAZE_STATS_DUMP_PERIOD   0
+#endif
+
+#ifndef STATS_PRINTF
+#define STATS_PRINTF             printf
+#endif
+
+/**
+ * @brief Timed pipeline stages
+ * Engine stages mirror the [n/6] steps of dehaze_frame(); driver stages cover
+ * the hardware path.
+ */
+typedef enum {
+    STATS_STAGE_CONVERT = 0,    /**< Packed RGB -> planar float */
+    STATS_STAGE_ALE,            /**< Atmospheric light estimation */
+    STATS_STAGE_ED,             /**< Edge detection map */
+    STATS_STAGE_TE,             /**< Transmission estimation */
+    STATS_STAGE_SR,             /**< Scene recovery */
+    STATS_STAGE_SC,             /**< Saturation correction and pack */
+    STATS_STAGE_DIFF,           /**< Frame-difference tile scan (skip mode) */
+    STATS_STAGE_ENCODE,         /**< Wait for the output encoder after the last band */
+    STATS_STAGE_DMA,            /**< DMA start -> S2MM completion interrupt */
+    STATS_STAGE_UNPACK,         /**< 32-bit -> 8-bit RGB conversion */
+    STATS_STAGE_UART,           /**< UART transmission */
+    STATS_NUM_STAGES
+} HazeStats_Stage;
+
+/**
+ * @brief Snapshot of all counters
+ * Times are in XTime counts (COUNTS_PER_SECOND per second).
+ */
+typedef struct {
+    XTime stage_ticks[STATS_NUM_STAGES];    /**< Accumulated time per stage */
+    u32   stage_calls[STATS_NUM_STAGES];    /**< Number of timed executions per stage */
+
+    u32   frames_processed;                 /**< Frames completed */
+    u32   frames_dropped;                   /**< Frames lost (I/O or DMA failure) */
+
+    u32   dma_queue_depth;                  /**< Outstanding DMA transfers */
+    u32   dma_queue_depth_max;              /**< High-water mark of the above */
+
+    volatile XTime isr_timestamp;           /**< Set by ProcessingCompletionISR() */
+    XTime isr_latency_last;                 /**< ISR -> consumer wake-up, last frame */
+    XTime isr_latency_max;
+    XTime isr_latency_total;
+    u32   isr_count;
+
+    u32   ed_histogram[STATS_ED_CLASSES];   /**< Accumulated ED class counts */
+
+    u32   tiles_recomputed;                 /**< Skip mode: tiles found changed */
+    u32   tiles_total;                      /**< Skip mode: tiles compared */
+
+    u32   srsc_rebuilds;                    /**< SRSC table rebuilds (parameter changes) */
+    float omega_last, t0_last;              /**< Parameters of the last rebuild */
+
+    struct { float r, g, b; } ac_history[STATS_AC_HISTORY];
+    u32   ac_count;                         /**< Total Ac samples recorded */
+} HazeStats;
+
+#ifdef HAZE_STATS_ENABLE
+
+static HazeStats HazeStatsData;
+
+//==========================================================================================
+// COUNTER UPDATES
+//==========================================================================================
+
+/**
+ * @brief Charge the time since *t to a stage and restart *t
+ */
+static inline void haze_stats_lap(HazeStats_Stage stage, XTime *t) {
+    XTime now;
+    XTime_GetTime(&now);
+    HazeStatsData.stage_ticks[stage] += now - *t;
+    HazeStatsData.stage_calls[stage]++;
+    *t = now;
+}
+
+static inline void haze_stats_dma_submit(void) {
+    if (++HazeStatsData.dma_queue_depth > HazeStatsData.dma_queue_depth_max)
+        HazeStatsData.dma_queue_depth_max = HazeStatsData.dma_queue_depth;
+}
+
+static inline void haze_stats_dma_complete(void) {
+    if (HazeStatsData.dma_queue_depth > 0)
+        HazeStatsData.dma_queue_depth--;
+}
+
+/**
+ * @brief Called by the consumer once it observes completion signalled by the ISR
+ */
+static inline void haze_stats_isr_wakeup(void) {
+    XTime now, latency;
+    XTime_GetTime(&now);
+    latency = now - HazeStatsData.isr_timestamp;
+    HazeStatsData.isr_latency_last = latency;
+    HazeStatsData.isr_latency_total += latency;
+    if (latency > HazeStatsData.isr_latency_max)
+        HazeStatsData.isr_latency_max = latency;
+    HazeStatsData.isr_count++;
+}
+
+static inline void haze_stats_ac(float r, float g, float b) {
+    u32 slot = HazeStatsData.ac_count % STATS_AC_HISTORY;
+    HazeStatsData.ac_history[slot].r = r;
+    HazeStatsData.ac_history[slot].g = g;
+    HazeStatsData.ac_history[slot].b = b;
+    HazeStatsData.ac_count++;
+}
+
+static void haze_stats_dump(void);
+
+static inline void haze_stats_frame_done(void) {
+    HazeStatsData.frames_processed++;
+#if HAZE_STATS_DUMP_PERIOD > 0
+    if ((HazeStatsData.frames_processed % HAZE_STATS_DUMP_PERIOD) == 0)
+        haze_stats_dump();
+#endif
+}
+
+//==========================================================================================
+// QUERY API
+//==========================================================================================
+
+/**
+ * @brief Copy the current counters into *out
+ */
+static inline void haze_stats_get(HazeStats *out) {
+    *out = HazeStatsData;
+}
+
+static inline void haze_stats_reset(void) {
+    memset(&HazeStatsData, 0, sizeof(HazeStatsData));
+}
+
+/**
+ * @brief Print all counters
+ */
+static void haze_stats_dump(void) {
+    static const char *names[STATS_NUM_STAGES] = {
+        "convert", "ALE", "ED", "TE", "SR", "SC", "diff", "encode", "DMA", "unpack", "UART"
+    };
+    const HazeStats *s = &HazeStatsData;
+    double us_per_count = 1000000.0 / (double)COUNTS_PER_SECOND;
+    int i;
+
+    STATS_PRINTF("--- haze stats: %u frames, %u dropped ---\n",
+                 (unsigned)s->frames_processed, (unsigned)s->frames_dropped);
+    for (i = 0; i < STATS_NUM_STAGES; i++) {
+        if (s->stage_calls[i] == 0)
+            continue;
+        STATS_PRINTF("  %-8s %10.1f us avg (%u calls)\n", names[i],
+                     (double)s->stage_ticks[i] * us_per_count / s->stage_calls[i],
+                     (unsigned)s->stage_calls[i]);
+    }
+    if (s->dma_queue_depth_max)
+        STATS_PRINTF("  DMA queue depth %u (max %u)\n",
+                     (unsigned)s->dma_queue_depth, (unsigned)s->dma_queue_depth_max);
+    if (s->isr_count)
+        STATS_PRINTF("  ISR latency %.2f us last, %.2f us avg, %.2f us max\n",
+                     (double)s->isr_latency_last * us_per_count,
+                     (double)s->isr_latency_total * us_per_count / s->isr_count,
+                     (double)s->isr_latency_max * us_per_count);
+    if (s->ed_histogram[0] + s->ed_histogram[1] + s->ed_histogram[2])
+        STATS_PRINTF("  ED classes smooth=%u vh=%u diag=%u\n",
+                     (unsigned)s->ed_histogram[0], (unsigned)s->ed_histogram[1],
+                     (unsigned)s->ed_histogram[2]);
+    if (s->tiles_total)
+        STATS_PRINTF("  Skip mode recomputed %u of %u tiles (%.1f%%)\n",
+                     (unsigned)s->tiles_recomputed, (unsigned)s->tiles_total,
+                     100.0 * s->tiles_recomputed / s->tiles_total);
+    if (s->srsc_rebuilds)
+        STATS_PRINTF("  SRSC tables rebuilt %u times, last omega=%.4f t0=%.4f\n",
+                     (unsigned)s->srsc_rebuilds, s->omega_last, s->t0_last);
+    for (i = 0; i < STATS_AC_HISTORY && (u32)i < s->ac_count; i++) {
+        u32 n = s->ac_count - 1 - i;    // most recent first
+        u32 slot = n % STATS_AC_HISTORY;
+        STATS_PRINTF("  Ac[%u] = (R:%.2f, G:%.2f, B:%.2f)\n", (unsigned)n,
+                     s->ac_history[slot].r, s->ac_history[slot].g, s->ac_history[slot].b);
+    }
+}
+
+//==========================================================================================
+// INSTRUMENTATION MACROS
+//==========================================================================================
+#define STATS_TIMER(t)              XTime t; XTime_GetTime(&t)
+#define STATS_RESTART(t)            XTime_GetTime(&t)
+#define STATS_LAP(stage, t)         haze_stats_lap((stage), &(t))
+#define STATS_ADD(stage, ticks)     (HazeStatsData.stage_ticks[(stage)] += (ticks), \
+                                     HazeStatsData.stage_calls[(stage)]++)
+#define STATS_FRAME_DONE()          haze_stats_frame_done()
+#define STATS_FRAME_DROPPED()       (HazeStatsData.frames_dropped++)
+#define STATS_DMA_SUBMIT()          haze_stats_dma_submit()
+#define STATS_DMA_COMPLETE()        haze_stats_dma_complete()
+#define STATS_ISR_STAMP()           XTime_GetTime((XTime *)&HazeStatsData.isr_timestamp)
+#define STATS_ISR_WAKEUP()          haze_stats_isr_wakeup()
+#define STATS_ED_ADD(cls, n)        (HazeStatsData.ed_histogram[(cls)] += (n))
+#define STATS_TILES(changed, total) (HazeStatsData.tiles_recomputed += (changed), \
+                                     HazeStatsData.tiles_total += (total))
+#define STATS_SRSC_REBUILD(p)       (HazeStatsData.srsc_rebuilds++, \
+                                     HazeStatsData.omega_last = (p)->omega, \
+                                     HazeStatsData.t0_last = (p)->t0)
+#define STATS_AC(ac)                haze_stats_ac((ac)->r, (ac)->g, (ac)->b)
+#define STATS_DUMP()                haze_stats_dump()
+
+#else  // !HAZE_STATS_ENABLE
+
+#define STATS_TIMER(t)
+#define STATS_RESTART(t)            ((void)0)
+#define STATS_LAP(stage, t)         ((void)0)
+#define STATS_ADD(stage, ticks)     ((void)0)
+#define STATS_FRAME_DONE()          ((void)0)
+#define STATS_FRAME_DROPPED()       ((void)0)
+#define STATS_DMA_SUBMIT()          ((void)0)
+#define STATS_DMA_COMPLETE()        ((void)0)
+#define STATS_ISR_STAMP()           ((void)0)
+#define STATS_ISR_WAKEUP()          ((void)0)
+#define STATS_ED_ADD(cls, n)        ((void)0)
+#define STATS_TILES(changed, total) ((void)0)
+#define STATS_SRSC_REBUILD(p)       ((void)0)
+#define STATS_AC(ac)                ((void)0)
+#define STATS_DUMP()                ((void)0)
+
+#endif // HAZE_STATS_ENABLE
+
+#endif // HAZEREMOVAL_STATS_H
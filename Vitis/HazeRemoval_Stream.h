@@ -0,0 +1,477 @@
+/**
+ * @file HazeRemoval_Stream.h
+ * @brief Video stream frontend for the host build of the software engine
+ * @description Reads frame sequences from stdin, files or named pipes and writes the
+ *              dehazed frames back in the same container, so the engine can sit in an
+ *              ffmpeg pipeline:
+ *
+ *              ffmpeg -i in.mp4 -vf scale=512:512 -pix_fmt yuv420p -f yuv4mpegpipe - |
+ *                  ./haze_sw -f y4m | ffmpeg -f yuv4mpegpipe -i - out.mp4
+ *
+ *              Reading and decoding run on a dedicated I/O thread that keeps up to
+ *              HAZE_STREAM_PREFETCH frames ready in engine format (packed XRGB32), so
+ *              decode overlaps processing of the previous frame.
+ *
+ * @author Rohan M
+ * @date 18th October 2026
+ * @version 1.0
+ *
+ * Formats:
+ * - y4m     YUV4MPEG2, 4:2:0 (C420, C420jpeg, C420paldv, C420mpeg2), BT.601, limited
+ *           range unless tagged XCOLORRANGE=FULL; chroma is replicated on input and
+ *           2x2-averaged on output
+ * - rgb24   Raw interleaved R,G,B bytes
+ * - xrgb32  Raw 32-bit words [23:16]=R [15:8]=G [7:0]=B, host byte order
+ * - qoi     Output only: concatenated QOI images, encoded in the pipeline by
+ *           HazeRemoval_Encoder.h and written with haze_stream_write_bytes()
+ * Frames must be IMG_WIDTH x IMG_HEIGHT; scale upstream (e.g. ffmpeg -vf scale).
+ *
+ * Configuration:
+ * - HAZE_STREAM_PREFETCH   Decoded frames buffered ahead of the engine (default: 4)
+ *
+ * Requires u8, u32, IMG_WIDTH, IMG_HEIGHT, IMG_SIZE and LOG to be defined before inclusion.
+ */
+#ifndef HAZEREMOVAL_STREAM_H
+#define HAZEREMOVAL_STREAM_H
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//==========================================================================================
+// CONFIGURATION
+//==========================================================================================
+#ifndef HAZE_STREAM_PREFETCH
+#define HAZE_STREAM_PREFETCH     4
+#endif
+
+#define HAZE_Y4M_MAGIC           "YUV4MPEG2"
+#define HAZE_Y4M_LINE_MAX        256        /**< Longest stream/frame header accepted */
+#define HAZE_I420_BYTES          (IMG_SIZE + 2 * (IMG_SIZE / 4))
+
+//==========================================================================================
+// TYPE DEFINITIONS
+//==========================================================================================
+typedef enum {
+    HAZE_FMT_XRGB32 = 0,
+    HAZE_FMT_RGB24,
+    HAZE_FMT_Y4M,
+    HAZE_FMT_QOI
+} HazeStream_Format;
+
+typedef struct {
+    FILE *fp;
+    HazeStream_Format fmt;
+    char y4m_params[HAZE_Y4M_LINE_MAX];  /**< Stream header after the magic, echoed on output */
+    int  full_range;                     /**< y4m: XCOLORRANGE=FULL */
+    u8  *raw;                            /**< Undecoded frame bytes (I/O thread only) */
+
+    // Ring of decoded frames; the slot at tail stays owned by the consumer until released
+    u32 *slots[HAZE_STREAM_PREFETCH];
+    int  head, tail, count;
+    int  eof;                            /**< No more frames will be produced */
+    int  error;                          /**< Stream ended on a malformed or truncated frame */
+    int  stop;
+
+    int             started;             /**< I/O thread running */
+    pthread_t       thread;
+    pthread_mutex_t lock;
+    pthread_cond_t  not_empty;
+    pthread_cond_t  not_full;
+} HazeStreamReader;
+
+typedef struct {
+    FILE *fp;
+    HazeStream_Format fmt;
+    int  full_range;
+    u8  *buf;                            /**< Encoded frame */
+} HazeStreamWriter;
+
+//==========================================================================================
+// FORMAT HELPERS
+//==========================================================================================
+
+/**
+ * @brief Map a format name (y4m, rgb24, xrgb32, qoi) to HazeStream_Format
+ * @return 0 on success, -1 for an unknown name
+ */
+static inline int haze_stream_parse_format(const char *name, HazeStream_Format *fmt) {
+    if (strcmp(name, "y4m") == 0)         *fmt = HAZE_FMT_Y4M;
+    else if (strcmp(name, "rgb24") == 0)  *fmt = HAZE_FMT_RGB24;
+    else if (strcmp(name, "xrgb32") == 0) *fmt = HAZE_FMT_XRGB32;
+    else if (strcmp(name, "qoi") == 0)    *fmt = HAZE_FMT_QOI;
+    else return -1;
+    return 0;
+}
+
+static inline u8 haze_clamp_u8(int v) {
+    return (u8)((v < 0) ? 0 : ((v > 255) ? 255 : v));
+}
+
+/**
+ * @brief Validate a YUV4MPEG2 stream header (without the magic) against the engine
+ * Rejects other frame sizes and non-4:2:0 chroma; records the colour range.
+ */
+static inline int haze_y4m_parse_params(const char *params, int *full_range) {
+    char buf[HAZE_Y4M_LINE_MAX];
+    int width = 0, height = 0;
+
+    *full_range = 0;
+    strncpy(buf, params, sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = '\0';
+
+    for (char *tok = strtok(buf, " \n"); tok; tok = strtok(NULL, " \n")) {
+        switch (tok[0]) {
+            case 'W': width = atoi(tok + 1); break;
+            case 'H': height = atoi(tok + 1); break;
+            case 'C':
+                // 8-bit 4:2:0 only; C420p10 and friends carry 16-bit samples
+                if (strcmp(tok + 1, "420") != 0 && strcmp(tok + 1, "420jpeg") != 0 &&
+                    strcmp(tok + 1, "420paldv") != 0 && strcmp(tok + 1, "420mpeg2") != 0) {
+                    LOG("ERROR: y4m colourspace %s not supported (need 8-bit 4:2:0)\n", tok + 1);
+                    return -1;
+                }
+                break;
+            case 'X':
+                if (strcmp(tok + 1, "COLORRANGE=FULL") == 0)
+                    *full_range = 1;
+                break;
+            default: break;     // Frame rate, interlacing, aspect: passed through
+        }
+    }
+
+    if (width != IMG_WIDTH || height != IMG_HEIGHT) {
+        LOG("ERROR: y4m frame size %dx%d, engine needs %dx%d\n",
+            width, height, IMG_WIDTH, IMG_HEIGHT);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief BT.601 I420 -> packed XRGB32 (8-bit fixed point, chroma replicated 2x2)
+ */
+static inline void haze_i420_to_xrgb32(const u8 *yuv, u32 *out, int full_range) {
+    const u8 *y_plane = yuv;
+    const u8 *u_plane = yuv + IMG_SIZE;
+    const u8 *v_plane = yuv + IMG_SIZE + IMG_SIZE / 4;
+
+    for (int row = 0; row < IMG_HEIGHT; row++) {
+        for (int col = 0; col < IMG_WIDTH; col++) {
+            int c = (row / 2) * (IMG_WIDTH / 2) + col / 2;
+            int y = y_plane[row * IMG_WIDTH + col];
+            int d = u_plane[c] - 128;
+            int e = v_plane[c] - 128;
+            int r, g, b;
+
+            if (full_range) {
+                r = y + ((359 * e + 128) >> 8);
+                g = y - ((88 * d + 183 * e + 128) >> 8);
+                b = y + ((454 * d + 128) >> 8);
+            } else {
+                y = 298 * (y - 16);
+                r = (y + 409 * e + 128) >> 8;
+                g = (y - 100 * d - 208 * e + 128) >> 8;
+                b = (y + 516 * d + 128) >> 8;
+            }
+
+            out[row * IMG_WIDTH + col] = ((u32)haze_clamp_u8(r) << 16) |
+                                         ((u32)haze_clamp_u8(g) << 8) |
+                                          (u32)haze_clamp_u8(b);
+        }
+    }
+}
+
+/**
+ * @brief Interleaved RGB24 -> BT.601 I420 (chroma from the 2x2 average)
+ */
+static inline void haze_rgb24_to_i420(const u8 *rgb, u8 *yuv, int full_range) {
+    u8 *y_plane = yuv;
+    u8 *u_plane = yuv + IMG_SIZE;
+    u8 *v_plane = yuv + IMG_SIZE + IMG_SIZE / 4;
+
+    for (int i = 0; i < IMG_SIZE; i++) {
+        int r = rgb[i * 3 + 0], g = rgb[i * 3 + 1], b = rgb[i * 3 + 2];
+        y_plane[i] = full_range ? haze_clamp_u8((77 * r + 150 * g + 29 * b + 128) >> 8)
+                                : haze_clamp_u8(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+    }
+
+    for (int row = 0; row < IMG_HEIGHT; row += 2) {
+        for (int col = 0; col < IMG_WIDTH; col += 2) {
+            const u8 *p0 = rgb + (row * IMG_WIDTH + col) * 3;
+            const u8 *p1 = p0 + IMG_WIDTH * 3;
+            int r = (p0[0] + p0[3] + p1[0] + p1[3] + 2) >> 2;
+            int g = (p0[1] + p0[4] + p1[1] + p1[4] + 2) >> 2;
+            int b = (p0[2] + p0[5] + p1[2] + p1[5] + 2) >> 2;
+            int c = (row / 2) * (IMG_WIDTH / 2) + col / 2;
+
+            if (full_range) {
+                u_plane[c] = haze_clamp_u8(((-43 * r - 85 * g + 128 * b + 128) >> 8) + 128);
+                v_plane[c] = haze_clamp_u8(((128 * r - 107 * g - 21 * b + 128) >> 8) + 128);
+            } else {
+                u_plane[c] = haze_clamp_u8(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+                v_plane[c] = haze_clamp_u8(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+            }
+        }
+    }
+}
+
+//==========================================================================================
+// READER (I/O THREAD)
+//==========================================================================================
+
+/**
+ * @brief Read and decode one frame into dst
+ * @return 1 on success, 0 at a clean end of stream, -1 on a malformed or truncated frame
+ */
+static inline int haze_stream_read_frame(HazeStreamReader *r, u32 *dst) {
+    char line[HAZE_Y4M_LINE_MAX];
+    size_t got;
+
+    switch (r->fmt) {
+        case HAZE_FMT_Y4M:
+            if (!fgets(line, sizeof(line), r->fp))
+                return 0;
+            if (strncmp(line, "FRAME", 5) != 0) {
+                LOG("ERROR: y4m frame header expected\n");
+                return -1;
+            }
+            if (fread(r->raw, 1, HAZE_I420_BYTES, r->fp) != HAZE_I420_BYTES)
+                return -1;
+            haze_i420_to_xrgb32(r->raw, dst, r->full_range);
+            return 1;
+
+        case HAZE_FMT_RGB24:
+            got = fread(r->raw, 1, IMG_SIZE * 3, r->fp);
+            if (got != IMG_SIZE * 3)
+                return got ? -1 : 0;
+            for (int i = 0; i < IMG_SIZE; i++)
+                dst[i] = ((u32)r->raw[i * 3] << 16) | ((u32)r->raw[i * 3 + 1] << 8) |
+                          (u32)r->raw[i * 3 + 2];
+            return 1;
+
+        default:
+            got = fread(dst, sizeof(u32), IMG_SIZE, r->fp);
+            if (got != IMG_SIZE)
+                return got ? -1 : 0;
+            return 1;
+    }
+}
+
+static void *haze_stream_reader_thread(void *arg) {
+    HazeStreamReader *r = (HazeStreamReader *)arg;
+    int status;
+
+    do {
+        pthread_mutex_lock(&r->lock);
+        while (r->count == HAZE_STREAM_PREFETCH && !r->stop)
+            pthread_cond_wait(&r->not_full, &r->lock);
+        if (r->stop) {
+            pthread_mutex_unlock(&r->lock);
+            break;
+        }
+        u32 *slot = r->slots[r->head];
+        pthread_mutex_unlock(&r->lock);
+
+        // Slots between tail and head are never touched here, so decode runs unlocked
+        status = haze_stream_read_frame(r, slot);
+
+        pthread_mutex_lock(&r->lock);
+        if (status == 1) {
+            r->head = (r->head + 1) % HAZE_STREAM_PREFETCH;
+            r->count++;
+        } else {
+            r->eof = 1;
+            r->error = (status < 0);
+        }
+        pthread_cond_signal(&r->not_empty);
+        pthread_mutex_unlock(&r->lock);
+    } while (status == 1);
+
+    return NULL;
+}
+
+static inline void haze_stream_reader_close(HazeStreamReader *r) {
+    if (r->started) {
+        pthread_mutex_lock(&r->lock);
+        r->stop = 1;
+        pthread_cond_signal(&r->not_full);
+        pthread_mutex_unlock(&r->lock);
+        pthread_join(r->thread, NULL);
+        pthread_mutex_destroy(&r->lock);
+        pthread_cond_destroy(&r->not_empty);
+        pthread_cond_destroy(&r->not_full);
+    }
+    for (int i = 0; i < HAZE_STREAM_PREFETCH; i++)
+        free(r->slots[i]);
+    free(r->raw);
+    if (r->fp && r->fp != stdin)
+        fclose(r->fp);
+    memset(r, 0, sizeof(*r));
+}
+
+/**
+ * @brief Open path ("-" or NULL for stdin), parse any stream header and start prefetching
+ * @return 0 on success, -1 on failure (nothing left open)
+ */
+static inline int haze_stream_reader_open(HazeStreamReader *r, const char *path,
+                                          HazeStream_Format fmt) {
+    char line[HAZE_Y4M_LINE_MAX];
+
+    memset(r, 0, sizeof(*r));
+    if (fmt == HAZE_FMT_QOI) {
+        LOG("ERROR: qoi is an output-only format\n");
+        return -1;
+    }
+    r->fmt = fmt;
+    r->fp = (!path || strcmp(path, "-") == 0) ? stdin : fopen(path, "rb");
+    if (!r->fp) {
+        LOG("ERROR: Cannot open input %s\n", path);
+        return -1;
+    }
+
+    // The stream header is parsed up front so the writer can mirror it
+    if (fmt == HAZE_FMT_Y4M) {
+        size_t magic = strlen(HAZE_Y4M_MAGIC);
+        if (!fgets(line, sizeof(line), r->fp) || strncmp(line, HAZE_Y4M_MAGIC, magic) != 0) {
+            LOG("ERROR: Input is not a YUV4MPEG2 stream\n");
+            haze_stream_reader_close(r);
+            return -1;
+        }
+        strncpy(r->y4m_params, line + magic, sizeof(r->y4m_params) - 1);
+        if (haze_y4m_parse_params(r->y4m_params, &r->full_range) != 0) {
+            haze_stream_reader_close(r);
+            return -1;
+        }
+    }
+
+    int ok = (r->raw = (u8*)malloc(IMG_SIZE * 3)) != NULL;
+    for (int i = 0; i < HAZE_STREAM_PREFETCH; i++)
+        ok &= (r->slots[i] = (u32*)malloc(sizeof(u32) * IMG_SIZE)) != NULL;
+    if (!ok) {
+        LOG("ERROR: Failed to allocate stream buffers\n");
+        haze_stream_reader_close(r);
+        return -1;
+    }
+
+    pthread_mutex_init(&r->lock, NULL);
+    pthread_cond_init(&r->not_empty, NULL);
+    pthread_cond_init(&r->not_full, NULL);
+    r->started = pthread_create(&r->thread, NULL, haze_stream_reader_thread, r) == 0;
+    if (!r->started) {
+        pthread_mutex_destroy(&r->lock);
+        pthread_cond_destroy(&r->not_empty);
+        pthread_cond_destroy(&r->not_full);
+        LOG("ERROR: Failed to start stream reader thread\n");
+        haze_stream_reader_close(r);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Block until the next decoded frame is ready
+ * @return Frame in engine format, valid until haze_stream_release(); NULL at end of stream
+ */
+static inline const u32 *haze_stream_next(HazeStreamReader *r) {
+    const u32 *frame;
+
+    pthread_mutex_lock(&r->lock);
+    while (r->count == 0 && !r->eof)
+        pthread_cond_wait(&r->not_empty, &r->lock);
+    frame = r->count ? r->slots[r->tail] : NULL;
+    pthread_mutex_unlock(&r->lock);
+    return frame;
+}
+
+/**
+ * @brief Hand the frame returned by haze_stream_next() back to the I/O thread
+ */
+static inline void haze_stream_release(HazeStreamReader *r) {
+    pthread_mutex_lock(&r->lock);
+    r->tail = (r->tail + 1) % HAZE_STREAM_PREFETCH;
+    r->count--;
+    pthread_cond_signal(&r->not_full);
+    pthread_mutex_unlock(&r->lock);
+}
+
+//==========================================================================================
+// WRITER
+//==========================================================================================
+
+/**
+ * @brief Open path ("-" or NULL for stdout) and write the stream header
+ * A y4m output repeats the y4m input header, or a 25 fps progressive header otherwise.
+ */
+static inline int haze_stream_writer_open(HazeStreamWriter *w, const char *path,
+                                          HazeStream_Format fmt, const HazeStreamReader *src) {
+    memset(w, 0, sizeof(*w));
+    w->fmt = fmt;
+    w->fp = (!path || strcmp(path, "-") == 0) ? stdout : fopen(path, "wb");
+    w->buf = (u8*)malloc(sizeof(u32) * IMG_SIZE);
+    if (!w->fp || !w->buf) {
+        LOG("ERROR: Cannot open output %s\n", path ? path : "-");
+        if (w->fp && w->fp != stdout)
+            fclose(w->fp);
+        free(w->buf);
+        return -1;
+    }
+
+    if (fmt == HAZE_FMT_Y4M) {
+        if (src->fmt == HAZE_FMT_Y4M) {
+            w->full_range = src->full_range;
+            fprintf(w->fp, "%s%s", HAZE_Y4M_MAGIC, src->y4m_params);
+        } else {
+            fprintf(w->fp, "%s W%d H%d F25:1 Ip A1:1 C420jpeg\n",
+                    HAZE_Y4M_MAGIC, IMG_WIDTH, IMG_HEIGHT);
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Encode and write one RGB24 engine output frame
+ * @return 0 on success, -1 on a write error
+ */
+static inline int haze_stream_write(HazeStreamWriter *w, const u8 *rgb) {
+    switch (w->fmt) {
+        case HAZE_FMT_Y4M:
+            haze_rgb24_to_i420(rgb, w->buf, w->full_range);
+            if (fputs("FRAME\n", w->fp) == EOF ||
+                fwrite(w->buf, 1, HAZE_I420_BYTES, w->fp) != HAZE_I420_BYTES)
+                return -1;
+            return 0;
+
+        case HAZE_FMT_XRGB32: {
+            u32 *words = (u32 *)w->buf;
+            for (int i = 0; i < IMG_SIZE; i++)
+                words[i] = ((u32)rgb[i * 3] << 16) | ((u32)rgb[i * 3 + 1] << 8) |
+                            (u32)rgb[i * 3 + 2];
+            return fwrite(words, sizeof(u32), IMG_SIZE, w->fp) == IMG_SIZE ? 0 : -1;
+        }
+
+        default:
+            return fwrite(rgb, 1, IMG_SIZE * 3, w->fp) == IMG_SIZE * 3 ? 0 : -1;
+    }
+}
+
+/**
+ * @brief Write one already encoded frame (HAZE_FMT_QOI)
+ * @return 0 on success, -1 on a write error
+ */
+static inline int haze_stream_write_bytes(HazeStreamWriter *w, const u8 *data, u32 size) {
+    return fwrite(data, 1, size, w->fp) == size ? 0 : -1;
+}
+
+static inline void haze_stream_writer_close(HazeStreamWriter *w) {
+    if (w->fp) {
+        fflush(w->fp);
+        if (w->fp != stdout)
+            fclose(w->fp);
+    }
+    free(w->buf);
+    memset(w, 0, sizeof(*w));
+}
+
+#endif // HAZEREMOVAL_STREAM_H
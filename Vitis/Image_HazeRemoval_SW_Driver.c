@@ -16,14 +16,17 @@
  * - AXI-DMA for high-throughput data transfers
  * - UART for external communication of results
  * - Interrupt-driven processing completion detection
+ * - Event-driven waits (WFI) so the core is free while the IP and UART are busy
+ * - Separate cache-line-aligned DMA buffers with range-limited cache maintenance
  *
  * Processing Flow:
  * 1. Initialize system peripherals (UART, DMA, Interrupts)
- * 2. Configure DMA transfers (DDR -> IP -> DDR)
+ * 2. Configure DMA transfers (DDR -> IP -> DDR), flushing only the MM2S source
+ *    range and invalidating only the S2MM destination range
  * 3. Start concurrent MM2S and S2MM transfers
- * 4. Wait for interrupt-driven completion
- * 5. Convert 32-bit pixel data to 8-bit format
- * 6. Transmit results via UART
+ * 4. Sleep until the completion interrupt posts HAZE_EVENT_DMA_DONE
+ * 5. Convert 32-bit pixel data to 8-bit format (completion callback, thread context)
+ * 6. Transmit results via interrupt-driven UART, sleeping until HAZE_EVENT_UART_DONE
  * 7. Report execution timing
  */
 
@@ -39,7 +42,11 @@
 #include "xil_cache.h"         // Cache management functions
 #include "xil_io.h"            // Memory-mapped I/O functions
 #include <stdio.h>             // Standard I/O functions
+#include <string.h>            // Memory functions
 #include "TestImage.h"         // Test image data header
+#include "HazeRemoval_Stats.h" // Hot-path counters (-DHAZE_STATS_ENABLE)
+#include "HazeRemoval_Event.h" // Event-driven completion signalling
+#include "HazeRemoval_DmaBuffer.h" // Cache-aware DMA buffers
 
 //==========================================================================================
 // SYSTEM CONFIGURATION CONSTANTS
@@ -58,17 +65,31 @@
 #define NO_OF_PASSES     2          /**< Number of processing passes through the image
                                          Pass 1: Atmospheric Light Estimation
                                          Pass 2: Transmission Estimation & Scene Recovery */
+#define DMA_INPUT_BYTES  (IMG_SIZE * NO_OF_PASSES * sizeof(u32)) /**< MM2S transfer size */
+#define DMA_OUTPUT_BYTES (IMG_SIZE * sizeof(u32))                /**< S2MM transfer size */
+
+//==========================================================================================
+// DMA BUFFER POOLS
+// Define HAZE_DMA_OUTPUT_NONCACHEABLE to place the S2MM buffer in a non-cacheable
+// pool: the CPU then reads the output straight from DDR with no invalidation
+//==========================================================================================
+#define DMA_POOL_SIZE    (HAZE_DMA_ALIGN_UP(DMA_INPUT_BYTES, HAZE_DMA_CACHE_LINE) + \
+                          HAZE_DMA_ALIGN_UP(DMA_OUTPUT_BYTES, HAZE_DMA_CACHE_LINE))
+#define DMA_NC_POOL_SIZE HAZE_DMA_ALIGN_UP(DMA_OUTPUT_BYTES, HAZE_DMA_SECTION_SIZE)
 
 //==========================================================================================
 // FUNCTION PROTOTYPES
 //==========================================================================================
 static void ProcessingCompletionISR(void *CallBackRef);
+static void ProcessingDoneCallback(u32 Events, void *CallBackRef);
+static void UartHandler(void *CallBackRef, u32 Event, u32 EventData);
 
 //==========================================================================================
 // GLOBAL VARIABLES
 //==========================================================================================
 XScuGic Intr_Instance;         /**< Global Interrupt Controller instance */
-int ProcessingComplete = 0;     /**< Processing completion flag (set by ISR) */
+XTime   StartTime;             /**< Performance timing start (before DMA start) */
+XTime   EndTime;               /**< Completion timestamp (set by ProcessingDoneCallback) */
 
 /**
  * @brief Final processed image data buffer
@@ -77,6 +98,14 @@ int ProcessingComplete = 0;     /**< Processing completion flag (set by ISR) */
  */
 u8 FinalData[NUMBER_OF_BYTES];
 
+static u8 DmaPoolMem[DMA_POOL_SIZE] __attribute__((aligned(HAZE_DMA_CACHE_LINE)));
+#ifdef HAZE_DMA_OUTPUT_NONCACHEABLE
+static u8 DmaNcPoolMem[DMA_NC_POOL_SIZE] __attribute__((aligned(HAZE_DMA_SECTION_SIZE)));
+#endif
+
+HazeDmaBuffer InputBuffer;     /**< MM2S source: image streamed NO_OF_PASSES times */
+HazeDmaBuffer OutputBuffer;    /**< S2MM destination: processed 32-bit pixels */
+
 //==========================================================================================
 // MAIN FUNCTION
 //==========================================================================================
@@ -85,11 +114,7 @@ int main() {
     //==================================================================================
     // LOCAL VARIABLES
     //==================================================================================
-    int i;                      /**< Loop iterator */
     u32 status;                 /**< Function return status */
-    u32 TotalBytesSent = 0;     /**< UART transmission progress counter */
-    u32 BurstSize      = 0;     /**< Actual bytes sent per UART burst */
-    XTime StartTime, EndTime;   /**< Performance timing variables */
 
     //==================================================================================
     // UART PERIPHERAL INITIALIZATION AND CONFIGURATION
@@ -132,6 +157,13 @@ int main() {
         return -1;
     }
 
+    //==================================================================================
+    // EVENT SIGNALLING
+    // ISRs post events; main sleeps in WFI and completion work runs as callbacks
+    //==================================================================================
+    haze_event_init();
+    haze_event_register(HAZE_EVENT_DMA_DONE, ProcessingDoneCallback, NULL);
+
     // Enable DMA Stream-to-Memory-Mapped (S2MM) interrupt
     // This interrupt fires when processed data transfer from IP to DDR completes
     XAxiDma_IntrEnable(&DMA_Instance, XAXIDMA_IRQ_IOC_MASK, XAXIDMA_DEVICE_TO_DMA);
@@ -171,6 +203,22 @@ int main() {
     // Enable the specific DMA interrupt in the interrupt controller
     XScuGic_Enable(&Intr_Instance, XPAR_FABRIC_AXI_DMA_0_S2MM_INTROUT_INTR);
 
+    // Route the UART interrupt through the driver's handler so XUartPs_Send()
+    // refills the TX FIFO from the ISR instead of the main loop polling it
+    status = XScuGic_Connect(&Intr_Instance,
+                             XPAR_XUARTPS_1_INTR,
+                             (Xil_InterruptHandler)XUartPs_InterruptHandler,
+                             (void *)&UART_Instance);
+    if (status != XST_SUCCESS) {
+        xil_printf("UART interrupt connection failed\n");
+        return -1;
+    }
+    // TXEMPTY is left out: with an empty send buffer it would fire at once and report
+    // a zero-byte send. XUartPs_SendBuffer() enables it per send while RXOVR is set.
+    XUartPs_SetHandler(&UART_Instance, (XUartPs_Handler)UartHandler, &UART_Instance);
+    XUartPs_SetInterruptMask(&UART_Instance, XUARTPS_IXR_RXOVR | XUARTPS_IXR_TOUT);
+    XScuGic_Enable(&Intr_Instance, XPAR_XUARTPS_1_INTR);
+
     // Initialize and configure ARM exception handling system
     Xil_ExceptionInit();
 
@@ -182,16 +230,49 @@ int main() {
     // Enable ARM processor interrupt handling
     Xil_ExceptionEnable();
 
+    //==================================================================================
+    // DMA BUFFER ALLOCATION
+    // Separate, cache-line-aligned source and destination buffers so that cleaning
+    // the input and invalidating the output never touch each other's lines
+    //==================================================================================
+    HazeDmaPool DmaPool;
+
+    if (haze_dma_pool_init(&DmaPool, DmaPoolMem, DMA_POOL_SIZE, 1) != XST_SUCCESS ||
+        haze_dma_alloc(&DmaPool, DMA_INPUT_BYTES, &InputBuffer) != XST_SUCCESS) {
+        xil_printf("DMA buffer allocation failed\n");
+        return -1;
+    }
+
+#ifdef HAZE_DMA_OUTPUT_NONCACHEABLE
+    HazeDmaPool DmaNcPool;
+
+    status = haze_dma_pool_init(&DmaNcPool, DmaNcPoolMem, DMA_NC_POOL_SIZE, 0);
+    if (status == XST_SUCCESS)
+        status = haze_dma_alloc(&DmaNcPool, DMA_OUTPUT_BYTES, &OutputBuffer);
+#else
+    status = haze_dma_alloc(&DmaPool, DMA_OUTPUT_BYTES, &OutputBuffer);
+#endif
+    if (status != XST_SUCCESS) {
+        xil_printf("DMA buffer allocation failed\n");
+        return -1;
+    }
+
+    // Stage the test image (both passes) in the MM2S buffer
+    memcpy(InputBuffer.ptr, imageData, DMA_INPUT_BYTES);
+
     //==================================================================================
     // IMAGE PROCESSING EXECUTION
     // Configure and execute DMA transfers for haze removal processing
     //==================================================================================
 
-    Xil_DCacheFlush();
-
     // Start performance timing measurement
     XTime_GetTime(&StartTime);
 
+    // Range-limited cache maintenance: clean the bytes MM2S will read, and
+    // invalidate the bytes S2MM will write so no dirty line lands on top of them
+    haze_dma_sync_for_device(&InputBuffer, DMA_INPUT_BYTES);
+    haze_dma_sync_for_receive(&OutputBuffer, DMA_OUTPUT_BYTES);
+
     /**
      * DMA Transfer Configuration:
      *
@@ -208,52 +289,29 @@ int main() {
 
     // Configure S2MM transfer (processed data from IP to DDR)
     status = XAxiDma_SimpleTransfer(&DMA_Instance,
-                                    (u32)imageData,                    // Destination buffer
-                                    IMG_SIZE * sizeof(u32),            // Transfer size
+                                    (UINTPTR)OutputBuffer.ptr,         // Destination buffer
+                                    DMA_OUTPUT_BYTES,                  // Transfer size
                                     XAXIDMA_DEVICE_TO_DMA);            // Direction: IP -> DDR
+    if (status == XST_SUCCESS) STATS_DMA_SUBMIT();
 
     // Configure MM2S transfer (input data from DDR to IP)
     status = XAxiDma_SimpleTransfer(&DMA_Instance,
-                                    (u32)imageData,                    // Source buffer
-                                    IMG_SIZE * NO_OF_PASSES * sizeof(u32), // Transfer size
+                                    (UINTPTR)InputBuffer.ptr,          // Source buffer
+                                    DMA_INPUT_BYTES,                   // Transfer size
                                     XAXIDMA_DMA_TO_DEVICE);            // Direction: DDR -> IP
 
     if (status != XST_SUCCESS) {
         xil_printf("DMA transfer configuration failed\n");
+        STATS_FRAME_DROPPED();
+        STATS_DUMP();
         return -1;
     }
+    STATS_DMA_SUBMIT();     // Both transfers are now outstanding
 
-    // Wait for processing completion (signaled by interrupt)
-    // ProcessingComplete flag is set by ProcessingCompletionISR()
-    while (!ProcessingComplete) {
-        // Processor remains in low-power state while IP processes data
-    }
-
-    Xil_DCacheFlush();
-
-    // Stop performance timing measurement
-    XTime_GetTime(&EndTime);
-
-    //==================================================================================
-    // DATA FORMAT CONVERSION
-    // Convert 32-bit pixel format to 8-bit RGB format for UART transmission
-    //==================================================================================
-
-    /**
-     * Data Format Conversion:
-     * Input:  32-bit words [31:24]=unused, [23:16]=R, [15:8]=G, [7:0]=B
-     * Output: 8-bit stream [R0,G0,B0,R1,G1,B1,R2,G2,B2,...]
-     *
-     * This conversion is necessary because:
-     * 1. UART transmits 8-bit data efficiently
-     * 2. External systems expect standard RGB byte format
-     * 3. Removes unused upper 8 bits to reduce transmission overhead
-     */
-    for (i = 0; i < NUMBER_OF_BYTES; i = i + 3) {
-        FinalData[i]   = (u8)(imageData[i/3] >> 16);    // Extract Red channel
-        FinalData[i+1] = (u8)(imageData[i/3] >> 8);     // Extract Green channel
-        FinalData[i+2] = (u8)(imageData[i/3]);          // Extract Blue channel
-    }
+    // Sleep until ProcessingCompletionISR() posts HAZE_EVENT_DMA_DONE.
+    // ProcessingDoneCallback() stops the timer and unpacks the pixels before
+    // haze_event_wait() returns.
+    haze_event_wait(HAZE_EVENT_DMA_DONE);
 
     //==================================================================================
     // UART DATA TRANSMISSION
@@ -261,26 +319,17 @@ int main() {
     //==================================================================================
 
     /**
-     * Burst Transmission Strategy:
-     * - Sends data in BURST_SIZE chunks to optimize throughput
-     * - Includes small delay between bursts to prevent buffer overflow
-     * - Tracks progress to ensure complete transmission
-     * - Handles partial burst transmission on final chunk
+     * Interrupt-Driven Transmission:
+     * - XUartPs_Send() fills the TX FIFO and returns immediately
+     * - The UART ISR refills the FIFO on TX-empty until the buffer is drained
+     * - UartHandler() then posts HAZE_EVENT_UART_DONE
+     * - The core sleeps in WFI in between instead of polling XUartPs_IsSending()
      */
-    while (TotalBytesSent < NUMBER_OF_BYTES) {
-        // Send burst of data (returns actual bytes sent)
-        BurstSize = XUartPs_Send(&UART_Instance,
-                                 (u8*)&FinalData[TotalBytesSent],
-                                 BURST_SIZE);
-
-        // Update transmission progress
-        TotalBytesSent += BurstSize;
-
-        while (XUartPs_IsSending(&UART_Instance)) {
-            // Busy wait to prevent buffer overflow
-        }
-
-    }
+    STATS_TIMER(t_stage);
+    XUartPs_Send(&UART_Instance, FinalData, NUMBER_OF_BYTES);
+    haze_event_wait(HAZE_EVENT_UART_DONE);
+    STATS_LAP(STATS_STAGE_UART, t_stage);
+    STATS_FRAME_DONE();
 
     //==================================================================================
     // PERFORMANCE REPORTING
@@ -290,13 +339,14 @@ int main() {
     /**
      * Execution Time Calculation:
      * - StartTime: Captured before DMA transfer initiation
-     * - EndTime: Captured after processing completion interrupt
+     * - EndTime: Captured by the completion callback after the interrupt
      * - Includes: DMA setup, IP processing time, DMA completion
      * - Excludes: Data format conversion and UART transmission
      */
 
     printf("Execution Time = %f ms \n\r",
            ((EndTime - StartTime) * 1000.0) / COUNTS_PER_SECOND);
+    STATS_DUMP();
 
     return 1;  // Successful completion
 }
@@ -316,13 +366,14 @@ int main() {
  * ISR Execution Flow:
  * 1. Disable further S2MM interrupts to prevent spurious interrupts
  * 2. Acknowledge the current interrupt to clear interrupt flag
- * 3. Set global completion flag for main thread
+ * 3. Post HAZE_EVENT_DMA_DONE to wake main()
  * 4. Re-enable interrupts for potential future operations
  *
  * Threading Notes:
  * - This ISR runs in interrupt context with higher priority than main()
- * - ProcessingComplete flag provides thread-safe communication with main()
- * - No complex processing should be done in ISR to minimize interrupt latency
+ * - haze_event_post() orders the ISR's writes before the event with a barrier
+ * - No complex processing should be done in ISR to minimize interrupt latency;
+ *   completion work runs in ProcessingDoneCallback()
  */
 static void ProcessingCompletionISR(void *CallBackRef) {
 
@@ -337,11 +388,74 @@ static void ProcessingCompletionISR(void *CallBackRef) {
     // Required to prevent interrupt from being serviced repeatedly
     XAxiDma_IntrAckIrq(DmaPtr, XAXIDMA_IRQ_IOC_MASK, XAXIDMA_DEVICE_TO_DMA);
 
+    // Timestamp for ISR -> main wake-up latency. The S2MM stream can only
+    // finish after the IP has consumed the whole MM2S stream, so both
+    // outstanding transfers are retired here.
+    STATS_ISR_STAMP();
+    STATS_DMA_COMPLETE();
+    STATS_DMA_COMPLETE();
+
     // Signal main thread that processing is complete
-    // This flag is polled by main() to detect completion
-    ProcessingComplete = 1;
+    haze_event_post(HAZE_EVENT_DMA_DONE);
 
     // Re-enable S2MM interrupts for potential future transfers
     // System is ready for next processing cycle
     XAxiDma_IntrEnable(DmaPtr, XAXIDMA_IRQ_IOC_MASK, XAXIDMA_DEVICE_TO_DMA);
 }
+
+//==========================================================================================
+// COMPLETION CALLBACKS
+//==========================================================================================
+
+/**
+ * @brief Processing completion callback (thread context)
+ * @description Dispatched by haze_event_wait() after ProcessingCompletionISR() posts
+ *              HAZE_EVENT_DMA_DONE. Stops the execution timer and converts the
+ *              processed pixels for UART transmission.
+ *
+ * Data Format Conversion:
+ * Input:  32-bit words [31:24]=unused, [23:16]=R, [15:8]=G, [7:0]=B
+ * Output: 8-bit stream [R0,G0,B0,R1,G1,B1,R2,G2,B2,...]
+ *
+ * This conversion is necessary because:
+ * 1. UART transmits 8-bit data efficiently
+ * 2. External systems expect standard RGB byte format
+ * 3. Removes unused upper 8 bits to reduce transmission overhead
+ */
+static void ProcessingDoneCallback(u32 Events, void *CallBackRef) {
+    const u32 *Pixels = (const u32 *)OutputBuffer.ptr;
+    int i;
+
+    (void)Events;
+    (void)CallBackRef;
+    STATS_ISR_WAKEUP();
+
+    // Drop any lines of the output fetched while S2MM was writing it
+    haze_dma_sync_for_cpu(&OutputBuffer, DMA_OUTPUT_BYTES);
+
+    // Stop performance timing measurement
+    XTime_GetTime(&EndTime);
+    STATS_ADD(STATS_STAGE_DMA, EndTime - StartTime);
+    STATS_TIMER(t_unpack);
+
+    for (i = 0; i < NUMBER_OF_BYTES; i = i + 3) {
+        FinalData[i]   = (u8)(Pixels[i/3] >> 16);       // Extract Red channel
+        FinalData[i+1] = (u8)(Pixels[i/3] >> 8);        // Extract Green channel
+        FinalData[i+2] = (u8)(Pixels[i/3]);             // Extract Blue channel
+    }
+    STATS_LAP(STATS_STAGE_UNPACK, t_unpack);
+}
+
+/**
+ * @brief UART event handler (interrupt context, called from XUartPs_InterruptHandler)
+ * @description Posts HAZE_EVENT_UART_DONE once the whole send buffer has left the FIFO.
+ *              EventData is the byte count of the finished send; anything short of the
+ *              frame (e.g. a TX-empty report with nothing queued) is ignored.
+ */
+static void UartHandler(void *CallBackRef, u32 Event, u32 EventData) {
+    (void)CallBackRef;
+
+    if (Event == XUARTPS_EVENT_SENT_DATA && EventData == NUMBER_OF_BYTES) {
+        haze_event_post(HAZE_EVENT_UART_DONE);
+    }
+}
@@ -19,16 +19,72 @@
 //==========================================================================================
 // SYSTEM INCLUDES
 //==========================================================================================
+#ifdef HOST_BUILD
+/*
+ * Host (Linux) build: gcc -O3 -DHOST_BUILD SW_Implementation_ARM.c -o haze_sw -lm -pthread
+ *   haze_sw [-f y4m|rgb24|xrgb32] [-F y4m|rgb24|xrgb32|qoi] [-i input] [-o output]
+ *           [-a] [-p name=value ...] [-q fp32|fp16|fixed] [-e]
+ * Streams frames through the engine (see HazeRemoval_Stream.h). -f selects the input
+ * format and, unless -F is given, the output format; without either, raw XRGB32 in and
+ * packed RGB24 out, as used by Python/Regression_Suite.py. Input and output default to
+ * stdin/stdout and may be files or named pipes. -F qoi compresses each output frame
+ * losslessly in the pipeline (see HazeRemoval_Encoder.h). -a enables parameter
+ * auto-tuning and -p overrides a runtime parameter (sigma, d_threshold, omega, t0,
+ * beta). -q selects the TE/SR precision tier and -e reports its error against fp32
+ * at exit. The engine runs as a simulated device thread behind the
+ * HazeRemoval_Event.h model.
+ */
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+typedef uint8_t  u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t XTime;
+#define COUNTS_PER_SECOND   1000000000ULL
+#define Xil_DCacheFlush()   ((void)0)
+static inline void XTime_GetTime(XTime *t) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    *t = (XTime)ts.tv_sec * 1000000000ULL + (XTime)ts.tv_nsec;
+}
+#else
 #include "xparameters.h"
 #include "xuartps.h"
 #include <xtime_l.h>
 #include "sleep.h"
 #include "xil_cache.h"
+#include "TestImage.h"
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
-#include "TestImage.h"
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Messages go to stderr on the host so stdout carries only pixel data;
+// per-stage progress is only printed on the board (one frame per run)
+#ifdef HOST_BUILD
+#define LOG(...)         fprintf(stderr, __VA_ARGS__)
+#define LOG_STEP(...)    ((void)0)
+#else
+#define LOG(...)         xil_printf(__VA_ARGS__)
+#define LOG_STEP(...)    xil_printf(__VA_ARGS__)
+#endif
+
+// Hot-path counters (-DHAZE_STATS_ENABLE). Host dumps share the LOG channel; the
+// board keeps the header's printf default, as xil_printf has no %f conversions
+#ifdef HOST_BUILD
+#define STATS_PRINTF     LOG
+#endif
+#include "HazeRemoval_Stats.h"
+#include "HazeRemoval_Event.h"
+#include "HazeRemoval_Precision.h"
+#include "HazeRemoval_Encoder.h"
 
 //==========================================================================================
 // CONFIGURATION CONSTANTS
@@ -41,13 +97,61 @@
 #define IMG_SIZE         (IMG_WIDTH * IMG_HEIGHT)
 #define NUMBER_OF_BYTES  (IMG_SIZE * 3)
 
-// Algorithm parameters (Shiau et al. 2013)
+// Algorithm parameters (Shiau et al. 2013): defaults of the runtime HazeParams block
 #define SIGMA            0.875f      // Atmospheric light scaling
 #define D_THRESHOLD      80          // Edge detection threshold
 #define OMEGA_PRIME      0.9375f     // Transmission estimation weight
 #define T0               0.25f       // Minimum transmission
 #define BETA             0.3f        // Saturation correction exponent
 
+// Auto-tune of omega'/t0 from the dark channel histogram (HazeWorkspace.auto_tune)
+#ifndef HAZE_AUTO_TUNE
+#define HAZE_AUTO_TUNE           0           // Default for new workspaces
+#endif
+#define HIST_BINS        32                  // Dark channel histogram bins...
+#define HIST_SHIFT       3                   // ...of 8 levels each
+#define TUNE_OMEGA_MIN   0.75f               // omega' for a haze-free frame
+#define TUNE_OMEGA_MAX   0.95f               // omega' for a fully hazy frame
+#define TUNE_T0_MIN      0.15f
+#define TUNE_T0_MAX      0.35f
+#define TUNE_EMA         0.25f               // Temporal smoothing of the haze estimate
+#define TUNE_STEP        (1.0f / 64.0f)      // Tuned values are quantised to this step
+
+// Precision of the transmission map and scene recovery (HazeWorkspace.precision):
+// HAZE_PREC_FP32, HAZE_PREC_FP16 or HAZE_PREC_FIXED (see HazeRemoval_Precision.h)
+#ifndef HAZE_PRECISION
+#define HAZE_PRECISION           HAZE_PREC_FP32  // Default for new workspaces
+#endif
+
+// Board build: transmit the QOI-encoded frame (HazeRemoval_Encoder.h) over UART
+// instead of the raw NUMBER_OF_BYTES
+#ifndef HAZE_ENCODE_OUTPUT
+#define HAZE_ENCODE_OUTPUT       0
+#endif
+
+// Scene recovery / saturation correction tables (cf. SRSC_Instantiations/*_LUT.v)
+#define SRSC_LUT_BITS    12
+#define SRSC_LUT_SIZE    (1 << SRSC_LUT_BITS)
+
+// Frame-difference skip mode for static cameras (HazeWorkspace.frame_skip)
+#ifndef HAZE_FRAME_SKIP
+#define HAZE_FRAME_SKIP          0           // Default for new workspaces
+#endif
+#ifndef HAZE_SKIP_SAD_PER_PIXEL
+#define HAZE_SKIP_SAD_PER_PIXEL  2           // Mean |dR|+|dG|+|dB| tolerated per pixel
+#endif
+#define SKIP_TILE        32                  // Tile edge in pixels
+#define SKIP_TILES_X     (IMG_WIDTH / SKIP_TILE)
+#define SKIP_TILES_Y     (IMG_HEIGHT / SKIP_TILE)
+#define SKIP_NUM_TILES   (SKIP_TILES_X * SKIP_TILES_Y)
+#define SKIP_HALO        1                   // 3x3 neighbourhoods reach 1 pixel out
+#define SKIP_SAD_THRESHOLD (HAZE_SKIP_SAD_PER_PIXEL * SKIP_TILE * SKIP_TILE)
+
+#ifdef HOST_BUILD
+// Host stream frontend (needs the frame geometry above)
+#include "HazeRemoval_Stream.h"
+#endif
+
 //==========================================================================================
 // TYPE DEFINITIONS
 //==========================================================================================
@@ -55,6 +159,88 @@ typedef struct {
     float r, g, b;
 } Pixel_f;
 
+/**
+ * @brief Rectangle of pixels processed by a stage: rows [r0, r1), columns [c0, c1)
+ * Neighbourhood stages still reflect at the image border, not the region border.
+ */
+typedef struct {
+    int r0, r1, c0, c1;
+} ImageRegion;
+
+static const ImageRegion FullFrame = {0, IMG_HEIGHT, 0, IMG_WIDTH};
+
+/**
+ * @brief Runtime algorithm parameters
+ * Set with haze_set_params(); take effect from the next frame without recompiling.
+ */
+typedef struct {
+    float sigma;                         // Atmospheric light scaling
+    int   d_threshold;                   // Edge detection threshold
+    float omega;                         // Transmission estimation weight (omega')
+    float t0;                            // Minimum transmission
+    float beta;                          // Saturation correction exponent
+} HazeParams;
+
+static const HazeParams HazeParamsDefault = {SIGMA, D_THRESHOLD, OMEGA_PRIME, T0, BETA};
+
+/**
+ * @brief Lookup tables for scene recovery and saturation correction
+ * pow_j is sampled at SRSC_LUT_SIZE + 1 points over [0, 1] and linearly interpolated;
+ * recip_q26 is indexed by the Q0.10 transmission of the fixed-point tier.
+ * Rebuilt only when t0 or beta change.
+ */
+typedef struct {
+    float pow_j[SRSC_LUT_SIZE + 1];      // j^(1 - beta)
+    u8    recip_q26[Q_T_ONE + 1];        // 1 / max(t, t0) in Q2.6 (Transmission_Reciprocal_LUT)
+    float t0, beta;                      // Parameters the tables hold
+    int   valid;
+} HazeSrscTables;
+
+/**
+ * @brief Working buffers for one frame of the pipeline
+ * Allocated once and reused for every frame processed
+ */
+typedef struct {
+    float *img_float;                    // Planar input [R... G... B...]
+    u8    *img_u8;                       // Same planes as 8-bit integers
+    float *t_map;                        // Transmission map (HAZE_PREC_FP32)
+    u16   *t_map16;                      // Transmission map (HAZE_PREC_FP16 / Q0.10)
+    u8    *ED_map;                       // Edge classification map
+    float *s_minR, *s_minG, *s_minB;     // ALE min-filter scratch
+    float *j_r, *j_g, *j_b;              // Recovered scene radiance
+
+    // Runtime parameters and the tables derived from them
+    HazeParams params;                   // Used from the next frame on
+    HazeSrscTables *srsc;
+    int    auto_tune;                    // Derive omega'/t0 per frame; from HAZE_AUTO_TUNE
+    float  haze_level;                   // Smoothed haze estimate, < 0 before the first frame
+    u32    dark_hist[HIST_BINS];         // Dark channel histogram of the last ALE pass
+
+    // TE/SR precision tier, optionally checked against an fp32 shadow pipeline
+    HazePrecision precision;             // Initialised from HAZE_PRECISION
+    int    precision_report;             // Accumulate prec_err after every frame
+    HazePrecisionError prec_err;
+    float *prec_t;                       // fp32 shadow buffers, allocated on first use
+    float *prec_j;
+    u8    *prec_out;
+
+    // Optional lossless encoder fed band by band from the SC stage; NULL when disabled
+    HazeEncoder *encoder;
+
+    // Frame-difference skip mode: only tiles that changed since they were last
+    // processed (plus a halo) are recomputed, the rest of the output is reused
+    int    frame_skip;                   // Enable; initialised from HAZE_FRAME_SKIP
+    int    skip_valid;                   // Reference frame and caches populated
+    u32   *ref_input;                    // Input as of each tile's last recompute
+    u8    *out_cache;                    // Output as of each tile's last recompute
+    float  tile_dark_max[SKIP_NUM_TILES];  // Per-tile dark channel maximum...
+    int    tile_dark_idx[SKIP_NUM_TILES];  // ...and its first raster index
+    u32   *tile_dark_hist;               // ...and histogram [SKIP_NUM_TILES][HIST_BINS]
+    ImageRegion skip_regions[SKIP_NUM_TILES];  // Regions recomputed in the current frame
+    Pixel_f ac_prev;                     // Ac the cached output was computed with
+    HazeParams params_prev;              // Parameters the cached output was computed with
+} HazeWorkspace;
+
 //==========================================================================================
 // GLOBAL BUFFERS
 //==========================================================================================
@@ -94,25 +280,93 @@ static inline float get_pixel_reflect(const float *channel, int row, int col) {
     return channel[row * IMG_WIDTH + col];
 }
 
+/**
+ * @brief Sum of absolute byte differences over n bytes (n a multiple of 16)
+ * NEON on the A9, SSE2 on x86 hosts, scalar otherwise.
+ */
+static inline u32 sad_bytes(const u8 *a, const u8 *b, int n) {
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    uint32x4_t acc = vdupq_n_u32(0);
+    for (int k = 0; k < n; k += 16) {
+        uint8x16_t d = vabdq_u8(vld1q_u8(a + k), vld1q_u8(b + k));
+        acc = vpadalq_u16(acc, vpaddlq_u8(d));
+    }
+    return vgetq_lane_u32(acc, 0) + vgetq_lane_u32(acc, 1) +
+           vgetq_lane_u32(acc, 2) + vgetq_lane_u32(acc, 3);
+#elif defined(__SSE2__)
+    __m128i acc = _mm_setzero_si128();
+    for (int k = 0; k < n; k += 16) {
+        __m128i va = _mm_loadu_si128((const __m128i *)(a + k));
+        __m128i vb = _mm_loadu_si128((const __m128i *)(b + k));
+        acc = _mm_add_epi64(acc, _mm_sad_epu8(va, vb));
+    }
+    return (u32)_mm_cvtsi128_si32(acc) + (u32)_mm_cvtsi128_si32(_mm_srli_si128(acc, 8));
+#else
+    u32 sad = 0;
+    for (int k = 0; k < n; k++)
+        sad += (a[k] > b[k]) ? (u32)(a[k] - b[k]) : (u32)(b[k] - a[k]);
+    return sad;
+#endif
+}
+
+/**
+ * @brief Region covered by a skip-mode tile, grown by halo pixels and clipped to the image
+ */
+static inline void tile_region(int tile, int halo, ImageRegion *rg) {
+    int r0 = (tile / SKIP_TILES_X) * SKIP_TILE;
+    int c0 = (tile % SKIP_TILES_X) * SKIP_TILE;
+    rg->r0 = (r0 - halo < 0) ? 0 : r0 - halo;
+    rg->c0 = (c0 - halo < 0) ? 0 : c0 - halo;
+    rg->r1 = (r0 + SKIP_TILE + halo > IMG_HEIGHT) ? IMG_HEIGHT : r0 + SKIP_TILE + halo;
+    rg->c1 = (c0 + SKIP_TILE + halo > IMG_WIDTH) ? IMG_WIDTH : c0 + SKIP_TILE + halo;
+}
+
+/**
+ * @brief Has a tile changed by more than SKIP_SAD_THRESHOLD against the reference?
+ */
+static inline int tile_changed(const u32 *input, const u32 *ref, int tile) {
+    ImageRegion rg;
+    u32 sad = 0;
+
+    tile_region(tile, 0, &rg);
+    for (int row = rg.r0; row < rg.r1; row++) {
+        int i = row * IMG_WIDTH + rg.c0;
+        sad += sad_bytes((const u8 *)(input + i), (const u8 *)(ref + i), SKIP_TILE * 4);
+        if (sad > SKIP_SAD_THRESHOLD)
+            return 1;   // Early out
+    }
+    return 0;
+}
+
 //==========================================================================================
 // IMAGE PROCESSING FUNCTIONS
 //==========================================================================================
 
 /**
- * @brief Convert packed 32-bit RGB to planar float format
+ * @brief Convert packed 32-bit RGB to planar float and planar 8-bit formats
  * Input format: [31:24]=unused [23:16]=R [15:8]=G [7:0]=B
  * Output format: Planar [R R R ... G G G ... B B B ...]
+ * The 8-bit planes feed the integer ED filter kernels.
  */
-void convert_to_float_planar(const u32 *input, float *output) {
+void convert_to_float_planar(const u32 *input, float *output, u8 *output_u8,
+                             const ImageRegion *rg) {
     float *r_plane = output;
     float *g_plane = output + IMG_SIZE;
     float *b_plane = output + IMG_SIZE * 2;
+    u8 *r8_plane = output_u8;
+    u8 *g8_plane = output_u8 + IMG_SIZE;
+    u8 *b8_plane = output_u8 + IMG_SIZE * 2;
     
-    for (int i = 0; i < IMG_SIZE; i++) {
-        u32 pixel = input[i];
-        r_plane[i] = (float)((pixel >> 16) & 0xFF);
-        g_plane[i] = (float)((pixel >> 8) & 0xFF);
-        b_plane[i] = (float)(pixel & 0xFF);
+    for (int row = rg->r0; row < rg->r1; row++) {
+        for (int i = row * IMG_WIDTH + rg->c0; i < row * IMG_WIDTH + rg->c1; i++) {
+            u32 pixel = input[i];
+            r8_plane[i] = (u8)(pixel >> 16);
+            g8_plane[i] = (u8)(pixel >> 8);
+            b8_plane[i] = (u8)pixel;
+            r_plane[i] = (float)r8_plane[i];
+            g_plane[i] = (float)g8_plane[i];
+            b_plane[i] = (float)b8_plane[i];
+        }
     }
 }
 
@@ -120,9 +374,9 @@ void convert_to_float_planar(const u32 *input, float *output) {
  * @brief Apply 3x3 minimum filter (morphological erosion)
  * Used for dark channel prior computation
  */
-void min_filter_3x3(const float *input, float *output) {
-    for (int row = 0; row < IMG_HEIGHT; row++) {
-        for (int col = 0; col < IMG_WIDTH; col++) {
+void min_filter_3x3(const float *input, float *output, const ImageRegion *rg) {
+    for (int row = rg->r0; row < rg->r1; row++) {
+        for (int col = rg->c0; col < rg->c1; col++) {
             float min_val = 255.0f;
             
             // 3x3 neighborhood with reflection
@@ -138,49 +392,95 @@ void min_filter_3x3(const float *input, float *output) {
     }
 }
 
+/**
+ * @brief Atmospheric light from the pixel at idx, with sigma scaling and minimum guard
+ */
+static inline void set_atmospheric_light(const float *img_r, const float *img_g,
+                                         const float *img_b, int idx, float sigma,
+                                         Pixel_f *ac) {
+    ac->r = clampf(img_r[idx] * sigma, 1e-3f, 255.0f);
+    ac->g = clampf(img_g[idx] * sigma, 1e-3f, 255.0f);
+    ac->b = clampf(img_b[idx] * sigma, 1e-3f, 255.0f);
+}
+
+/**
+ * @brief Find the dark channel maximum (first in raster order) over a region
+ * The dark channel histogram for auto-tuning is accumulated into hist in the same pass.
+ */
+static inline void dark_channel_scan(const float *min_r, const float *min_g, const float *min_b,
+                                     const ImageRegion *rg, float *max_val, int *max_idx,
+                                     u32 *hist) {
+    float best = -1.0f;
+    int best_idx = 0;
+
+    for (int row = rg->r0; row < rg->r1; row++) {
+        for (int i = row * IMG_WIDTH + rg->c0; i < row * IMG_WIDTH + rg->c1; i++) {
+            float dark_prime = min3f(min_r[i], min_g[i], min_b[i]);
+            hist[(int)dark_prime >> HIST_SHIFT]++;
+            if (dark_prime > best) {
+                best = dark_prime;
+                best_idx = i;
+            }
+        }
+    }
+
+    *max_val = best;
+    *max_idx = best_idx;
+}
+
 /**
  * @brief Estimate atmospheric light using dark channel prior
  * Finds the pixel with maximum dark channel value and scales by sigma
  */
 void compute_atmospheric_light(const float *img_r, const float *img_g, const float *img_b,
                                Pixel_f *ac, int *loc_s, int *loc_t,
-                               float *scratch_minR, float *scratch_minG, float *scratch_minB) {
+                               float *scratch_minR, float *scratch_minG, float *scratch_minB,
+                               const HazeParams *p, u32 *hist) {
     // Apply 3x3 min filter per channel
-    min_filter_3x3(img_r, scratch_minR);
-    min_filter_3x3(img_g, scratch_minG);
-    min_filter_3x3(img_b, scratch_minB);
+    min_filter_3x3(img_r, scratch_minR, &FullFrame);
+    min_filter_3x3(img_g, scratch_minG, &FullFrame);
+    min_filter_3x3(img_b, scratch_minB, &FullFrame);
     
     // Find maximum of dark channel
-    float max_val = -1.0f;
-    int max_idx = 0;
-    
-    for (int i = 0; i < IMG_SIZE; i++) {
-        float dark_prime = min3f(scratch_minR[i], scratch_minG[i], scratch_minB[i]);
-        if (dark_prime > max_val) {
-            max_val = dark_prime;
-            max_idx = i;
-        }
-    }
+    float max_val;
+    int max_idx;
+
+    memset(hist, 0, sizeof(u32) * HIST_BINS);
+    dark_channel_scan(scratch_minR, scratch_minG, scratch_minB, &FullFrame,
+                      &max_val, &max_idx, hist);
     
     // Extract location
     *loc_s = max_idx / IMG_WIDTH;
     *loc_t = max_idx % IMG_WIDTH;
     
-    // Atmospheric light with sigma scaling and minimum guard
-    ac->r = clampf(img_r[max_idx] * SIGMA, 1e-3f, 255.0f);
-    ac->g = clampf(img_g[max_idx] * SIGMA, 1e-3f, 255.0f);
-    ac->b = clampf(img_b[max_idx] * SIGMA, 1e-3f, 255.0f);
+    set_atmospheric_light(img_r, img_g, img_b, max_idx, p->sigma, ac);
 }
 
+#ifdef HAZE_STATS_ENABLE
+/**
+ * @brief Add the ED classes of a region to the stats histogram
+ */
+static void stats_ed_region(const u8 *ed, const ImageRegion *rg) {
+    for (int row = rg->r0; row < rg->r1; row++)
+        for (int i = row * IMG_WIDTH + rg->c0; i < row * IMG_WIDTH + rg->c1; i++)
+            STATS_ED_ADD(ed[i], 1);
+}
+#define STATS_ED_REGION(ed, rg)  stats_ed_region((ed), (rg))
+#else
+#define STATS_ED_REGION(ed, rg)  ((void)0)
+#endif
+
 /**
  * @brief Compute Edge Detection (ED) map
  * Classifies pixels as: 0=smooth, 1=V/H edge, 2=diagonal edge
  */
-void compute_ED_map(const float *img_r, const float *img_g, const float *img_b, u8 *ed) {
+void compute_ED_map(const float *img_r, const float *img_g, const float *img_b, u8 *ed,
+                    const HazeParams *p, const ImageRegion *rg) {
+    float d_threshold = (float)p->d_threshold;
     int offsets[8][2] = {{-1,-1}, {-1,0}, {-1,1}, {0,-1}, {0,1}, {1,-1}, {1,0}, {1,1}};
     
-    for (int row = 0; row < IMG_HEIGHT; row++) {
-        for (int col = 0; col < IMG_WIDTH; col++) {
+    for (int row = rg->r0; row < rg->r1; row++) {
+        for (int col = rg->c0; col < rg->c1; col++) {
             int i = row * IMG_WIDTH + col;
             
             // Sample 8-connected neighbors
@@ -196,13 +496,13 @@ void compute_ED_map(const float *img_r, const float *img_g, const float *img_b,
             // Compute differences: diagonal and vertical/horizontal
             float diff_d1 = max3f(fabsf(r_n[0] - r_n[7]), fabsf(g_n[0] - g_n[7]), fabsf(b_n[0] - b_n[7]));
             float diff_d2 = max3f(fabsf(r_n[2] - r_n[5]), fabsf(g_n[2] - g_n[5]), fabsf(b_n[2] - b_n[5]));
-            float diff_v  = max3f(fabsf(r_n[1] - r_n[6]), fabsf(g_n[1] - g_n[6]), fabsf(b_n[1] - g_n[6]));
+            float diff_v  = max3f(fabsf(r_n[1] - r_n[6]), fabsf(g_n[1] - g_n[6]), fabsf(b_n[1] - b_n[6]));
             float diff_h  = max3f(fabsf(r_n[3] - r_n[4]), fabsf(g_n[3] - g_n[4]), fabsf(b_n[3] - b_n[4]));
             
             // Classify edge type
-            if (diff_d1 >= D_THRESHOLD || diff_d2 >= D_THRESHOLD)
+            if (diff_d1 >= d_threshold || diff_d2 >= d_threshold)
                 ed[i] = 2;  // Diagonal edge
-            else if (diff_v >= D_THRESHOLD || diff_h >= D_THRESHOLD)
+            else if (diff_v >= d_threshold || diff_h >= d_threshold)
                 ed[i] = 1;  // Vertical/horizontal edge
             else
                 ed[i] = 0;  // Smooth region
@@ -211,114 +511,156 @@ void compute_ED_map(const float *img_r, const float *img_g, const float *img_b,
 }
 
 /**
- * @brief Apply 2D convolution with reflection padding
+ * @brief Define a fully unrolled 3x3 ED filter kernel
+ * All three weight sets are symmetric with power-of-two taps, so each kernel is
+ * three shifted integer sums (corners, N/S/E/W edges, centre) and one final scale,
+ * the same shift-and-add structure as WindowFilter.v.
+ *
+ * p points at the centre pixel of a u8 plane; up/dn/lf/rt are the signed offsets
+ * to its neighbours, already reflected at the image border.
  */
-void apply_filter(const float *input, float *output, const float *kernel, int ksize) {
-    int offset = ksize / 2;
-    
-    for (int row = 0; row < IMG_HEIGHT; row++) {
-        for (int col = 0; col < IMG_WIDTH; col++) {
-            float sum = 0.0f;
-            
-            for (int kr = 0; kr < ksize; kr++) {
-                for (int kc = 0; kc < ksize; kc++) {
-                    int img_row = row - offset + kr;
-                    int img_col = col - offset + kc;
-                    float val = get_pixel_reflect(input, img_row, img_col);
-                    sum += val * kernel[kr * ksize + kc];
-                }
-            }
-            
-            output[row * IMG_WIDTH + col] = sum;
-        }
+#define DEFINE_ED_KERNEL_3x3(name, corner_shl, edge_shl, centre_shl, scale)                 \
+    static inline float name(const u8 *p, int up, int dn, int lf, int rt) {                \
+        int corners = p[up + lf] + p[up + rt] + p[dn + lf] + p[dn + rt];                   \
+        int edges   = p[up] + p[dn] + p[lf] + p[rt];                                       \
+        int sum     = (corners << (corner_shl)) + (edges << (edge_shl))                    \
+                    + (p[0] << (centre_shl));                                              \
+        return (float)sum * (scale);                                                       \
     }
-}
+
+DEFINE_ED_KERNEL_3x3(ed_kernel0_3x3, 0, 0, 0, 1.0f / 9.0f)    // {1,1,1, 1,1,1, 1,1,1} / 9
+DEFINE_ED_KERNEL_3x3(ed_kernel1_3x3, 0, 1, 2, 1.0f / 16.0f)   // {1,2,1, 2,4,2, 1,2,1} / 16
+DEFINE_ED_KERNEL_3x3(ed_kernel2_3x3, 1, 0, 2, 1.0f / 16.0f)   // {2,1,2, 1,4,1, 2,1,2} / 16
 
 /**
  * @brief Estimate transmission map with ED-adaptive filtering
- * Uses three different kernels based on edge classification
- */
-int estimate_transmission(const float *img_r, const float *img_g, const float *img_b,
-                         const Pixel_f *ac, const u8 *ed, float *t_out,
-                         float *tmp0_r, float *tmp0_g, float *tmp0_b,
-                         float *tmp1_r, float *tmp1_g, float *tmp1_b,
-                         float *tmp2_r, float *tmp2_g, float *tmp2_b) {
-    // Define filter kernels
-    float k0[9] = {1,1,1, 1,1,1, 1,1,1};  // Uniform filter
-    for (int i = 0; i < 9; i++) k0[i] /= 9.0f;
-    
-    float k1[9] = {1,2,1, 2,4,2, 1,2,1};  // Gaussian-like
-    for (int i = 0; i < 9; i++) k1[i] /= 16.0f;
-    
-    float k2[9] = {2,1,2, 1,4,1, 2,1,2};  // Inverse Gaussian
-    for (int i = 0; i < 9; i++) k2[i] /= 16.0f;
-    
-    // Apply all three filters to each channel
-    apply_filter(img_r, tmp0_r, k0, 3);
-    apply_filter(img_g, tmp0_g, k0, 3);
-    apply_filter(img_b, tmp0_b, k0, 3);
-    
-    apply_filter(img_r, tmp1_r, k1, 3);
-    apply_filter(img_g, tmp1_g, k1, 3);
-    apply_filter(img_b, tmp1_b, k1, 3);
-    
-    apply_filter(img_r, tmp2_r, k2, 3);
-    apply_filter(img_g, tmp2_g, k2, 3);
-    apply_filter(img_b, tmp2_b, k2, 3);
-    
-    // Compute transmission map
-    for (int i = 0; i < IMG_SIZE; i++) {
-        float Pc_r, Pc_g, Pc_b;
-        
-        // Select filtered value based on ED classification
-        switch (ed[i]) {
-            case 0:  // Smooth region
-                Pc_r = tmp0_r[i];
-                Pc_g = tmp0_g[i];
-                Pc_b = tmp0_b[i];
-                break;
-            case 1:  // V/H edge
-                Pc_r = tmp1_r[i];
-                Pc_g = tmp1_g[i];
-                Pc_b = tmp1_b[i];
-                break;
-            case 2:  // Diagonal edge
-                Pc_r = tmp2_r[i];
-                Pc_g = tmp2_g[i];
-                Pc_b = tmp2_b[i];
-                break;
-            default:
-                Pc_r = tmp0_r[i];
-                Pc_g = tmp0_g[i];
-                Pc_b = tmp0_b[i];
+ * Only the kernel selected by each pixel's ED class is evaluated. Each row's
+ * min_c(Pc / Ac) is gathered first and stored as t at the requested precision:
+ * float into t_out, or half / Q0.10 into t_out16.
+ */
+int estimate_transmission(const u8 *img_r8, const u8 *img_g8, const u8 *img_b8,
+                         const Pixel_f *ac, const u8 *ed, HazePrecision prec,
+                         float *t_out, u16 *t_out16,
+                         const HazeParams *p, const ImageRegion *rg) {
+    float ratio[IMG_WIDTH];
+    int n = rg->c1 - rg->c0;
+
+    for (int row = rg->r0; row < rg->r1; row++) {
+        // Reflected neighbour offsets (row -1 -> 1, row H -> H-2)
+        int up = (row == 0) ? IMG_WIDTH : -IMG_WIDTH;
+        int dn = (row == IMG_HEIGHT - 1) ? -IMG_WIDTH : IMG_WIDTH;
+
+        for (int col = rg->c0; col < rg->c1; col++) {
+            int i = row * IMG_WIDTH + col;
+            int lf = (col == 0) ? 1 : -1;
+            int rt = (col == IMG_WIDTH - 1) ? -1 : 1;
+            float Pc_r, Pc_g, Pc_b;
+
+            // Select filter based on ED classification
+            switch (ed[i]) {
+                case 1:  // V/H edge
+                    Pc_r = ed_kernel1_3x3(img_r8 + i, up, dn, lf, rt);
+                    Pc_g = ed_kernel1_3x3(img_g8 + i, up, dn, lf, rt);
+                    Pc_b = ed_kernel1_3x3(img_b8 + i, up, dn, lf, rt);
+                    break;
+                case 2:  // Diagonal edge
+                    Pc_r = ed_kernel2_3x3(img_r8 + i, up, dn, lf, rt);
+                    Pc_g = ed_kernel2_3x3(img_g8 + i, up, dn, lf, rt);
+                    Pc_b = ed_kernel2_3x3(img_b8 + i, up, dn, lf, rt);
+                    break;
+                default: // Smooth region
+                    Pc_r = ed_kernel0_3x3(img_r8 + i, up, dn, lf, rt);
+                    Pc_g = ed_kernel0_3x3(img_g8 + i, up, dn, lf, rt);
+                    Pc_b = ed_kernel0_3x3(img_b8 + i, up, dn, lf, rt);
+            }
+
+            // Compute min_c(Pc[c] / Ac[c])
+            float ratio_r = Pc_r / ac->r;
+            float ratio_g = Pc_g / ac->g;
+            float ratio_b = Pc_b / ac->b;
+            ratio[col - rg->c0] = min3f(ratio_r, ratio_g, ratio_b);
         }
-        
-        // Compute min_c(Pc[c] / Ac[c])
-        float ratio_r = Pc_r / ac->r;
-        float ratio_g = Pc_g / ac->g;
-        float ratio_b = Pc_b / ac->b;
-        float min_ratio = min3f(ratio_r, ratio_g, ratio_b);
-        
+
         // t = 1 - omega' * min_ratio
-        t_out[i] = clampf(1.0f - OMEGA_PRIME * min_ratio, 0.0f, 1.0f);
+        int base = row * IMG_WIDTH + rg->c0;
+        switch (prec) {
+            case HAZE_PREC_FP16:  te_store_fp16(ratio, p->omega, t_out16 + base, n);  break;
+            case HAZE_PREC_FIXED: te_store_fixed(ratio, p->omega, t_out16 + base, n); break;
+            default:              te_store_fp32(ratio, p->omega, t_out + base, n);
+        }
     }
-    
+
     return 0;
 }
 
+/**
+ * @brief (Re)build the SRSC tables if t0 or beta changed since they were last built
+ * @return 1 if the tables were rebuilt
+ */
+static int srsc_tables_update(HazeSrscTables *tab, const HazeParams *p) {
+    if (tab->valid && tab->t0 == p->t0 && tab->beta == p->beta)
+        return 0;
+
+    for (int k = 0; k <= SRSC_LUT_SIZE; k++)
+        tab->pow_j[k] = powf((float)k / SRSC_LUT_SIZE, 1.0f - p->beta);
+
+    // Q2.6 saturates at 255 (3.98), reached for t below 0.25
+    for (int k = 0; k <= Q_T_ONE; k++) {
+        float t = (float)k / Q_T_ONE;
+        float r = (float)(1 << Q_RECIP_FRAC) / ((t > p->t0) ? t : p->t0) + 0.5f;
+        tab->recip_q26[k] = (r >= 255.0f) ? 255 : (u8)r;
+    }
+    tab->t0 = p->t0;
+    tab->beta = p->beta;
+    tab->valid = 1;
+    return 1;
+}
+
+/**
+ * @brief Linearly interpolated SRSC table lookup, x in [0, 1]
+ */
+static inline float srsc_lookup(const float *lut, float x) {
+    float pos = x * SRSC_LUT_SIZE;
+    if (!(pos >= 0.0f)) pos = 0.0f;                     // Negative or NaN
+    if (pos > (float)SRSC_LUT_SIZE) pos = (float)SRSC_LUT_SIZE;
+    int k = (int)pos;
+    if (k >= SRSC_LUT_SIZE) k = SRSC_LUT_SIZE - 1;
+    return lut[k] + (lut[k + 1] - lut[k]) * (pos - (float)k);
+}
+
 /**
  * @brief Recover scene radiance using transmission map
  * J_c = (I_c - A_c) / max(t, t0) + A_c
+ * The float tiers read the float planes and t (fp32) or t16 (fp16); the fixed tier
+ * reads the 8-bit planes and the Q0.10 t16, with Ac rounded to 8 bits as on the IP.
  */
-void recover_scene(const float *img_r, const float *img_g, const float *img_b,
-                   const Pixel_f *ac, const float *t,
-                   float *out_r, float *out_g, float *out_b) {
-    for (int i = 0; i < IMG_SIZE; i++) {
-        float t_clamped = (t[i] > T0) ? t[i] : T0;
-        
-        out_r[i] = (img_r[i] - ac->r) / t_clamped + ac->r;
-        out_g[i] = (img_g[i] - ac->g) / t_clamped + ac->g;
-        out_b[i] = (img_b[i] - ac->b) / t_clamped + ac->b;
+void recover_scene(const float *img_float, const u8 *img_u8, const Pixel_f *ac,
+                   HazePrecision prec, const float *t, const u16 *t16,
+                   const HazeSrscTables *tab, float *out_r, float *out_g, float *out_b,
+                   const ImageRegion *rg) {
+    const float *img_r = img_float, *img_g = img_float + IMG_SIZE, *img_b = img_float + IMG_SIZE * 2;
+    const u8 *img_r8 = img_u8, *img_g8 = img_u8 + IMG_SIZE, *img_b8 = img_u8 + IMG_SIZE * 2;
+    u8 ac_r8 = (u8)clampf(ac->r + 0.5f, 0.0f, 255.0f);
+    u8 ac_g8 = (u8)clampf(ac->g + 0.5f, 0.0f, 255.0f);
+    u8 ac_b8 = (u8)clampf(ac->b + 0.5f, 0.0f, 255.0f);
+    int n = rg->c1 - rg->c0;
+
+    for (int row = rg->r0; row < rg->r1; row++) {
+        int i = row * IMG_WIDTH + rg->c0;
+
+        switch (prec) {
+            case HAZE_PREC_FP16:
+                sr_row_fp16(t16 + i, tab->t0, img_r + i, img_g + i, img_b + i,
+                            ac->r, ac->g, ac->b, out_r + i, out_g + i, out_b + i, n);
+                break;
+            case HAZE_PREC_FIXED:
+                sr_row_fixed(t16 + i, tab->recip_q26, img_r8 + i, img_g8 + i, img_b8 + i,
+                             ac_r8, ac_g8, ac_b8, out_r + i, out_g + i, out_b + i, n);
+                break;
+            default:
+                sr_row_fp32(t + i, tab->t0, img_r + i, img_g + i, img_b + i,
+                            ac->r, ac->g, ac->b, out_r + i, out_g + i, out_b + i, n);
+        }
     }
 }
 
@@ -327,90 +669,764 @@ void recover_scene(const float *img_r, const float *img_g, const float *img_b,
  * J_tilde_c = (A_c)^beta * J_c^(1-beta)
  */
 void saturation_correction_and_pack(const float *j_r, const float *j_g, const float *j_b,
-                                    const Pixel_f *ac, u8 *out_interleaved) {
+                                    const Pixel_f *ac, const HazeSrscTables *tab,
+                                    u8 *out_interleaved, const ImageRegion *rg) {
     // Precompute atmospheric light powers
     float ac_norm_r = clampf(ac->r / 255.0f, 1e-6f, 1.0f);
     float ac_norm_g = clampf(ac->g / 255.0f, 1e-6f, 1.0f);
     float ac_norm_b = clampf(ac->b / 255.0f, 1e-6f, 1.0f);
     
-    float ac_beta_r = powf(ac_norm_r, BETA);
-    float ac_beta_g = powf(ac_norm_g, BETA);
-    float ac_beta_b = powf(ac_norm_b, BETA);
-    float one_minus_beta = 1.0f - BETA;
+    float ac_beta_r = powf(ac_norm_r, tab->beta);
+    float ac_beta_g = powf(ac_norm_g, tab->beta);
+    float ac_beta_b = powf(ac_norm_b, tab->beta);
     
-    for (int i = 0; i < IMG_SIZE; i++) {
-        // Normalize to [0, 1]
-        float jr = clampf(j_r[i] / 255.0f, 0.0f, 1.0f);
-        float jg = clampf(j_g[i] / 255.0f, 0.0f, 1.0f);
-        float jb = clampf(j_b[i] / 255.0f, 0.0f, 1.0f);
+    for (int row = rg->r0; row < rg->r1; row++) {
+        for (int i = row * IMG_WIDTH + rg->c0; i < row * IMG_WIDTH + rg->c1; i++) {
+            // Normalize to [0, 1]
+            float jr = clampf(j_r[i] / 255.0f, 0.0f, 1.0f);
+            float jg = clampf(j_g[i] / 255.0f, 0.0f, 1.0f);
+            float jb = clampf(j_b[i] / 255.0f, 0.0f, 1.0f);
         
-        // Apply saturation correction
-        float cr = ac_beta_r * powf(jr, one_minus_beta);
-        float cg = ac_beta_g * powf(jg, one_minus_beta);
-        float cb = ac_beta_b * powf(jb, one_minus_beta);
+            // Apply saturation correction
+            float cr = ac_beta_r * srsc_lookup(tab->pow_j, jr);
+            float cg = ac_beta_g * srsc_lookup(tab->pow_j, jg);
+            float cb = ac_beta_b * srsc_lookup(tab->pow_j, jb);
         
-        // Convert to 8-bit with rounding
-        int ir = (int)(clampf(cr * 255.0f, 0.0f, 255.0f) + 0.5f);
-        int ig = (int)(clampf(cg * 255.0f, 0.0f, 255.0f) + 0.5f);
-        int ib = (int)(clampf(cb * 255.0f, 0.0f, 255.0f) + 0.5f);
+            // Convert to 8-bit with rounding
+            int ir = (int)(clampf(cr * 255.0f, 0.0f, 255.0f) + 0.5f);
+            int ig = (int)(clampf(cg * 255.0f, 0.0f, 255.0f) + 0.5f);
+            int ib = (int)(clampf(cb * 255.0f, 0.0f, 255.0f) + 0.5f);
         
-        out_interleaved[i * 3 + 0] = (u8)ir;
-        out_interleaved[i * 3 + 1] = (u8)ig;
-        out_interleaved[i * 3 + 2] = (u8)ib;
+            out_interleaved[i * 3 + 0] = (u8)ir;
+            out_interleaved[i * 3 + 1] = (u8)ig;
+            out_interleaved[i * 3 + 2] = (u8)ib;
+        }
     }
 }
 
+//==========================================================================================
+// PIPELINE
+//==========================================================================================
+
+/**
+ * @brief Release all working buffers (safe on a partially allocated workspace)
+ */
+void haze_workspace_free(HazeWorkspace *ws) {
+    free(ws->s_minR);
+    free(ws->s_minG);
+    free(ws->s_minB);
+
+    free(ws->j_r);
+    free(ws->j_g);
+    free(ws->j_b);
+
+    free(ws->img_float);
+    free(ws->img_u8);
+    free(ws->t_map);
+    free(ws->t_map16);
+    free(ws->ED_map);
+
+    free(ws->srsc);
+    free(ws->prec_t);
+    free(ws->prec_j);
+    free(ws->prec_out);
+
+    free(ws->ref_input);
+    free(ws->out_cache);
+    free(ws->tile_dark_hist);
+
+    memset(ws, 0, sizeof(*ws));
+}
+
+/**
+ * @brief Allocate all working buffers for the pipeline
+ * @return 0 on success, -1 if any allocation failed (partial allocations are released)
+ */
+int haze_workspace_alloc(HazeWorkspace *ws) {
+    memset(ws, 0, sizeof(*ws));
+
+    ws->img_float = (float*)malloc(sizeof(float) * IMG_SIZE * 3);
+    ws->img_u8 = (u8*)malloc(sizeof(u8) * IMG_SIZE * 3);
+    ws->t_map = (float*)malloc(sizeof(float) * IMG_SIZE);
+    ws->t_map16 = (u16*)malloc(sizeof(u16) * IMG_SIZE);
+    ws->ED_map = (u8*)malloc(sizeof(u8) * IMG_SIZE);
+
+    ws->s_minR = (float*)malloc(sizeof(float) * IMG_SIZE);
+    ws->s_minG = (float*)malloc(sizeof(float) * IMG_SIZE);
+    ws->s_minB = (float*)malloc(sizeof(float) * IMG_SIZE);
+
+    ws->j_r = (float*)malloc(sizeof(float) * IMG_SIZE);
+    ws->j_g = (float*)malloc(sizeof(float) * IMG_SIZE);
+    ws->j_b = (float*)malloc(sizeof(float) * IMG_SIZE);
+
+    ws->srsc = (HazeSrscTables*)calloc(1, sizeof(HazeSrscTables));
+    ws->params = HazeParamsDefault;
+    ws->auto_tune = HAZE_AUTO_TUNE;
+    ws->haze_level = -1.0f;
+    ws->precision = HAZE_PRECISION;
+
+    ws->ref_input = (u32*)malloc(sizeof(u32) * IMG_SIZE);
+    ws->out_cache = (u8*)malloc(sizeof(u8) * NUMBER_OF_BYTES);
+    ws->tile_dark_hist = (u32*)malloc(sizeof(u32) * SKIP_NUM_TILES * HIST_BINS);
+    ws->frame_skip = HAZE_FRAME_SKIP;
+
+    if (!ws->img_float || !ws->img_u8 || !ws->t_map || !ws->t_map16 || !ws->ED_map ||
+        !ws->s_minR || !ws->s_minG || !ws->s_minB ||
+        !ws->j_r || !ws->j_g || !ws->j_b || !ws->srsc ||
+        !ws->ref_input || !ws->out_cache || !ws->tile_dark_hist) {
+        LOG("ERROR: Failed to allocate working buffers\n");
+        haze_workspace_free(ws);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Replace the algorithm parameters; takes effect from the next frame
+ * With auto-tune enabled, omega and t0 are overridden per frame.
+ * @return 0 on success, -1 if a parameter is out of range (sigma > 0, d_threshold >= 0,
+ *         omega in [0, 1], t0 in (0, 1], beta in [0, 1)); the current set is kept
+ */
+int haze_set_params(HazeWorkspace *ws, const HazeParams *p) {
+    // Written so that NaN fails every test. Names only: xil_printf has no %f/%g
+    const char *bad = !(p->sigma > 0.0f)                        ? "sigma"
+                    : p->d_threshold < 0                         ? "d_threshold"
+                    : !(p->omega >= 0.0f && p->omega <= 1.0f)    ? "omega"
+                    : !(p->t0 > 0.0f && p->t0 <= 1.0f)           ? "t0"
+                    : !(p->beta >= 0.0f && p->beta < 1.0f)       ? "beta"
+                    : NULL;
+    if (bad) {
+        LOG("ERROR: Parameter %s out of range\n", bad);
+        return -1;
+    }
+    ws->params = *p;
+    return 0;
+}
+
+static inline int params_equal(const HazeParams *a, const HazeParams *b) {
+    return a->sigma == b->sigma && a->d_threshold == b->d_threshold &&
+           a->omega == b->omega && a->t0 == b->t0 && a->beta == b->beta;
+}
+
+/**
+ * @brief Derive omega' and t0 from the dark channel histogram of the ALE pass
+ * The median dark channel relative to the darkest Ac component estimates haze
+ * density (0 = clear, 1 = fully hazy). Denser haze gets a stronger omega' and a
+ * higher t0 floor against noise amplification. The estimate is smoothed over
+ * frames and the results are quantised to TUNE_STEP, so the SRSC tables are only
+ * rebuilt when the scene really changes.
+ */
+static void haze_auto_tune(HazeWorkspace *ws, const Pixel_f *ac, const u32 *hist) {
+    u32 count = 0, total = 0;
+    int bin = 0;
+
+    for (int k = 0; k < HIST_BINS; k++)
+        total += hist[k];
+    while (bin < HIST_BINS - 1 && (count += hist[bin]) * 2 < total)
+        bin++;
+
+    float median = ((float)bin + 0.5f) * (1 << HIST_SHIFT);
+    float level = clampf(median / min3f(ac->r, ac->g, ac->b), 0.0f, 1.0f);
+
+    ws->haze_level = (ws->haze_level < 0.0f) ? level
+                   : ws->haze_level + TUNE_EMA * (level - ws->haze_level);
+
+    float omega = TUNE_OMEGA_MIN + (TUNE_OMEGA_MAX - TUNE_OMEGA_MIN) * ws->haze_level;
+    float t0 = TUNE_T0_MIN + (TUNE_T0_MAX - TUNE_T0_MIN) * ws->haze_level;
+    ws->params.omega = floorf(omega / TUNE_STEP + 0.5f) * TUNE_STEP;
+    ws->params.t0 = floorf(t0 / TUNE_STEP + 0.5f) * TUNE_STEP;
+}
+
+/**
+ * @brief Settle this frame's parameters once Ac and the histogram are known
+ */
+static void haze_prepare_params(HazeWorkspace *ws, const Pixel_f *ac) {
+    if (ws->auto_tune)
+        haze_auto_tune(ws, ac, ws->dark_hist);
+    if (srsc_tables_update(ws->srsc, &ws->params))
+        STATS_SRSC_REBUILD(&ws->params);
+}
+
+/**
+ * @brief Frame-difference pipeline for static cameras
+ * Each SKIP_TILE x SKIP_TILE tile is compared (SAD) against the input it was last
+ * processed with. Unchanged tiles keep their cached output; changed tiles are
+ * re-ingested and only they, grown by SKIP_HALO for the 3x3 neighbourhoods, are run
+ * through the pipeline again. Ac is re-derived from per-tile dark channel maxima, and
+ * any change in Ac invalidates the whole cache since every stage after ALE depends on it.
+ * With HAZE_SKIP_SAD_PER_PIXEL 0 the output is identical to full processing.
+ */
+static void dehaze_frame_incremental(HazeWorkspace *ws, const u32 *input, u8 *output,
+                                     Pixel_f *ac) {
+    ImageRegion *regions = ws->skip_regions;
+    u8 changed[SKIP_NUM_TILES], dark_dirty[SKIP_NUM_TILES];
+    int n_changed = 0, n_regions = 0, n;
+    float *img_r = ws->img_float;
+    float *img_g = ws->img_float + IMG_SIZE;
+    float *img_b = ws->img_float + IMG_SIZE * 2;
+    ImageRegion rg;
+    STATS_TIMER(t_stage);
+
+    // Step 0: Find tiles that moved away from the cached reference
+    for (int t = 0; t < SKIP_NUM_TILES; t++) {
+        changed[t] = !ws->skip_valid || tile_changed(input, ws->ref_input, t);
+        n_changed += changed[t];
+    }
+    STATS_LAP(STATS_STAGE_DIFF, t_stage);
+    STATS_TILES(n_changed, SKIP_NUM_TILES);
+
+    // Nothing to do unless the parameters changed or auto-tune may still move them
+    if (n_changed == 0 && !ws->auto_tune && params_equal(&ws->params, &ws->params_prev)) {
+        *ac = ws->ac_prev;
+        memcpy(output, ws->out_cache, NUMBER_OF_BYTES);
+        if (ws->encoder)
+            haze_encoder_repeat(ws->encoder);       // Encoded frame is unchanged too
+        STATS_AC(ac);
+        STATS_FRAME_DONE();
+        return;
+    }
+
+    // Step 1: Ingest changed tiles into the reference frame and the planes
+    for (int t = 0; t < SKIP_NUM_TILES; t++) {
+        if (!changed[t])
+            continue;
+        tile_region(t, 0, &rg);
+        for (int row = rg.r0; row < rg.r1; row++)
+            memcpy(ws->ref_input + row * IMG_WIDTH + rg.c0, input + row * IMG_WIDTH + rg.c0,
+                   sizeof(u32) * SKIP_TILE);
+        convert_to_float_planar(input, ws->img_float, ws->img_u8, &rg);
+    }
+    STATS_LAP(STATS_STAGE_CONVERT, t_stage);
+
+    // Step 2: Dark channel around changed tiles, then refresh the maxima of every
+    // tile the halo reached and reduce them to the global maximum
+    memset(dark_dirty, 0, sizeof(dark_dirty));
+    for (int t = 0; t < SKIP_NUM_TILES; t++) {
+        if (!changed[t])
+            continue;
+        tile_region(t, SKIP_HALO, &rg);
+        min_filter_3x3(img_r, ws->s_minR, &rg);
+        min_filter_3x3(img_g, ws->s_minG, &rg);
+        min_filter_3x3(img_b, ws->s_minB, &rg);
+        for (int ty = rg.r0 / SKIP_TILE; ty <= (rg.r1 - 1) / SKIP_TILE; ty++)
+            for (int tx = rg.c0 / SKIP_TILE; tx <= (rg.c1 - 1) / SKIP_TILE; tx++)
+                dark_dirty[ty * SKIP_TILES_X + tx] = 1;
+    }
+
+    float max_val = -1.0f;
+    int max_idx = 0;
+
+    memset(ws->dark_hist, 0, sizeof(ws->dark_hist));
+    for (int t = 0; t < SKIP_NUM_TILES; t++) {
+        u32 *tile_hist = ws->tile_dark_hist + t * HIST_BINS;
+
+        if (dark_dirty[t]) {
+            tile_region(t, 0, &rg);
+            memset(tile_hist, 0, sizeof(u32) * HIST_BINS);
+            dark_channel_scan(ws->s_minR, ws->s_minG, ws->s_minB, &rg,
+                              &ws->tile_dark_max[t], &ws->tile_dark_idx[t], tile_hist);
+        }
+        for (int k = 0; k < HIST_BINS; k++)
+            ws->dark_hist[k] += tile_hist[k];
+
+        // Ties resolve to the first pixel in raster order, as in compute_atmospheric_light()
+        if (ws->tile_dark_max[t] > max_val ||
+            (ws->tile_dark_max[t] == max_val && ws->tile_dark_idx[t] < max_idx)) {
+            max_val = ws->tile_dark_max[t];
+            max_idx = ws->tile_dark_idx[t];
+        }
+    }
+
+    set_atmospheric_light(img_r, img_g, img_b, max_idx, ws->params.sigma, ac);
+    haze_prepare_params(ws, ac);
+    STATS_LAP(STATS_STAGE_ALE, t_stage);
+    STATS_AC(ac);
+
+    // Steps 3-6 over the whole frame when Ac or the parameters moved, otherwise
+    // over the changed tiles
+    int full = !ws->skip_valid || ac->r != ws->ac_prev.r || ac->g != ws->ac_prev.g ||
+               ac->b != ws->ac_prev.b || !params_equal(&ws->params, &ws->params_prev);
+    if (full) {
+        regions[n_regions++] = FullFrame;
+    } else {
+        for (int t = 0; t < SKIP_NUM_TILES; t++) {
+            if (changed[t])
+                tile_region(t, SKIP_HALO, &regions[n_regions++]);
+        }
+    }
+
+    for (n = 0; n < n_regions; n++)
+        compute_ED_map(img_r, img_g, img_b, ws->ED_map, &ws->params, &regions[n]);
+    // Halos overlap, so classes are counted over each changed tile's own pixels
+    if (full) {
+        STATS_ED_REGION(ws->ED_map, &FullFrame);
+    } else {
+        for (int t = 0; t < SKIP_NUM_TILES; t++) {
+            if (changed[t]) {
+                tile_region(t, 0, &rg);
+                STATS_ED_REGION(ws->ED_map, &rg);
+            }
+        }
+    }
+    STATS_LAP(STATS_STAGE_ED, t_stage);
+
+    for (n = 0; n < n_regions; n++)
+        estimate_transmission(ws->img_u8, ws->img_u8 + IMG_SIZE, ws->img_u8 + IMG_SIZE * 2,
+                              ac, ws->ED_map, ws->precision, ws->t_map, ws->t_map16,
+                              &ws->params, &regions[n]);
+    STATS_LAP(STATS_STAGE_TE, t_stage);
+
+    for (n = 0; n < n_regions; n++)
+        recover_scene(ws->img_float, ws->img_u8, ac, ws->precision, ws->t_map, ws->t_map16,
+                      ws->srsc, ws->j_r, ws->j_g, ws->j_b, &regions[n]);
+    STATS_LAP(STATS_STAGE_SR, t_stage);
+
+    for (n = 0; n < n_regions; n++)
+        saturation_correction_and_pack(ws->j_r, ws->j_g, ws->j_b, ac, ws->srsc,
+                                       ws->out_cache, &regions[n]);
+    memcpy(output, ws->out_cache, NUMBER_OF_BYTES);
+    STATS_LAP(STATS_STAGE_SC, t_stage);
+
+    // Tiles finish out of raster order, so the frame is encoded in one go
+    if (ws->encoder) {
+        haze_encoder_begin(ws->encoder, output);
+        haze_encoder_publish(ws->encoder, IMG_HEIGHT);
+        haze_encoder_finish(ws->encoder);
+        STATS_LAP(STATS_STAGE_ENCODE, t_stage);
+    }
+
+    ws->ac_prev = *ac;
+    ws->params_prev = ws->params;
+    ws->skip_valid = 1;
+    STATS_FRAME_DONE();
+}
+
+/**
+ * @brief Run the complete haze removal pipeline on one frame
+ * @param input  Packed 32-bit pixels [23:16]=R [15:8]=G [7:0]=B
+ * @param output Interleaved 8-bit RGB, NUMBER_OF_BYTES long
+ * @param ac     Receives the atmospheric light estimated for this frame
+ * With ws->frame_skip set, only tiles that changed since the previous frame are
+ * recomputed (see dehaze_frame_incremental()). With ws->encoder set, the output is
+ * also encoded, band by band as saturation correction finishes it, into ws->encoder->buf.
+ */
+void dehaze_frame(HazeWorkspace *ws, const u32 *input, u8 *output, Pixel_f *ac) {
+    if (ws->frame_skip) {
+        dehaze_frame_incremental(ws, input, output, ac);
+        return;
+    }
+
+    int loc_s = 0, loc_t = 0;
+    float *img_r = ws->img_float;
+    float *img_g = ws->img_float + IMG_SIZE;
+    float *img_b = ws->img_float + IMG_SIZE * 2;
+    STATS_TIMER(t_stage);
+
+    // Step 1: Convert to planar float format
+    LOG_STEP("[1/6] Converting image format...\n");
+    STATS_RESTART(t_stage);
+    convert_to_float_planar(input, ws->img_float, ws->img_u8, &FullFrame);
+    STATS_LAP(STATS_STAGE_CONVERT, t_stage);
+
+    // Step 2: Atmospheric light estimation
+    LOG_STEP("[2/6] Computing atmospheric light...\n");
+    STATS_RESTART(t_stage);
+    compute_atmospheric_light(img_r, img_g, img_b, ac, &loc_s, &loc_t,
+                              ws->s_minR, ws->s_minG, ws->s_minB, &ws->params, ws->dark_hist);
+    haze_prepare_params(ws, ac);
+    STATS_LAP(STATS_STAGE_ALE, t_stage);
+    STATS_AC(ac);
+    LOG_STEP("      Ac = (R:%.2f, G:%.2f, B:%.2f) at pixel (%d,%d)\n",
+        ac->r, ac->g, ac->b, loc_s, loc_t);
+
+    // Step 3: Edge detection map
+    LOG_STEP("[3/6] Computing edge detection map...\n");
+    STATS_RESTART(t_stage);
+    compute_ED_map(img_r, img_g, img_b, ws->ED_map, &ws->params, &FullFrame);
+    STATS_ED_REGION(ws->ED_map, &FullFrame);
+    STATS_LAP(STATS_STAGE_ED, t_stage);
+
+    // Step 4: Transmission estimation
+    LOG_STEP("[4/6] Estimating transmission map...\n");
+    STATS_RESTART(t_stage);
+    estimate_transmission(ws->img_u8, ws->img_u8 + IMG_SIZE, ws->img_u8 + IMG_SIZE * 2,
+                         ac, ws->ED_map, ws->precision, ws->t_map, ws->t_map16,
+                         &ws->params, &FullFrame);
+    STATS_LAP(STATS_STAGE_TE, t_stage);
+
+    // Step 5: Scene recovery
+    LOG_STEP("[5/6] Recovering scene radiance...\n");
+    STATS_RESTART(t_stage);
+    recover_scene(ws->img_float, ws->img_u8, ac, ws->precision, ws->t_map, ws->t_map16,
+                  ws->srsc, ws->j_r, ws->j_g, ws->j_b, &FullFrame);
+    STATS_LAP(STATS_STAGE_SR, t_stage);
+
+    // Step 6: Saturation correction, handing each finished band to the encoder
+    LOG_STEP("[6/6] Applying saturation correction...\n");
+    STATS_RESTART(t_stage);
+    if (ws->encoder) {
+        haze_encoder_begin(ws->encoder, output);
+        for (int r = 0; r < IMG_HEIGHT; r += HAZE_ENC_BAND_ROWS) {
+            ImageRegion band = {r, (r + HAZE_ENC_BAND_ROWS < IMG_HEIGHT) ? r + HAZE_ENC_BAND_ROWS
+                                                                         : IMG_HEIGHT,
+                                0, IMG_WIDTH};
+            saturation_correction_and_pack(ws->j_r, ws->j_g, ws->j_b, ac, ws->srsc, output, &band);
+            haze_encoder_publish(ws->encoder, band.r1);
+        }
+    } else {
+        saturation_correction_and_pack(ws->j_r, ws->j_g, ws->j_b, ac, ws->srsc, output, &FullFrame);
+    }
+    STATS_LAP(STATS_STAGE_SC, t_stage);
+
+    if (ws->encoder) {
+        haze_encoder_finish(ws->encoder);
+        STATS_LAP(STATS_STAGE_ENCODE, t_stage);
+    }
+
+    STATS_FRAME_DONE();
+}
+
+/**
+ * @brief Measure the last frame's precision tier against fp32
+ * Re-runs TE, SR and SC in fp32 on the workspace state the frame left behind and
+ * accumulates the transmission and output errors into ws->prec_err. Call after
+ * dehaze_frame(); the shadow buffers are allocated on first use.
+ * @return 0 on success, -1 if the shadow buffers could not be allocated
+ */
+int haze_precision_compare(HazeWorkspace *ws, const Pixel_f *ac, const u8 *output) {
+    HazePrecisionError *err = &ws->prec_err;
+    double sq_err = 0.0;
+
+    if (!ws->prec_t) {
+        ws->prec_t = (float*)malloc(sizeof(float) * IMG_SIZE);
+        ws->prec_j = (float*)malloc(sizeof(float) * IMG_SIZE * 3);
+        ws->prec_out = (u8*)malloc(sizeof(u8) * NUMBER_OF_BYTES);
+        if (!ws->prec_t || !ws->prec_j || !ws->prec_out) {
+            LOG("ERROR: Failed to allocate precision reference buffers\n");
+            return -1;
+        }
+    }
+
+    estimate_transmission(ws->img_u8, ws->img_u8 + IMG_SIZE, ws->img_u8 + IMG_SIZE * 2,
+                          ac, ws->ED_map, HAZE_PREC_FP32, ws->prec_t, NULL,
+                          &ws->params, &FullFrame);
+    recover_scene(ws->img_float, ws->img_u8, ac, HAZE_PREC_FP32, ws->prec_t, NULL, ws->srsc,
+                  ws->prec_j, ws->prec_j + IMG_SIZE, ws->prec_j + IMG_SIZE * 2, &FullFrame);
+    saturation_correction_and_pack(ws->prec_j, ws->prec_j + IMG_SIZE, ws->prec_j + IMG_SIZE * 2,
+                                   ac, ws->srsc, ws->prec_out, &FullFrame);
+
+    for (int i = 0; i < IMG_SIZE; i++) {
+        float t;
+        switch (ws->precision) {
+            case HAZE_PREC_FP16:  t = haze_f16_to_f32(ws->t_map16[i]); break;
+            case HAZE_PREC_FIXED: t = (float)ws->t_map16[i] / Q_T_ONE;  break;
+            default:              t = ws->t_map[i];
+        }
+        double d = fabs((double)t - (double)ws->prec_t[i]);
+        if (d > err->t_max_err)
+            err->t_max_err = d;
+    }
+
+    for (int i = 0; i < NUMBER_OF_BYTES; i++) {
+        int d = abs((int)output[i] - (int)ws->prec_out[i]);
+        sq_err += (double)(d * d);
+        if ((u32)d > err->out_max_diff)
+            err->out_max_diff = (u32)d;
+    }
+    err->out_sq_err += sq_err;
+    err->out_bytes += NUMBER_OF_BYTES;
+    err->frames++;
+    return 0;
+}
+
+#ifdef HOST_BUILD
+//==========================================================================================
+// MAIN FUNCTION (HOST)
+//==========================================================================================
+
+/**
+ * @brief Simulated accelerator for the host build
+ * The engine runs on its own thread and signals completion through the same event
+ * model as the board driver (HAZE_EVENT_FRAME_READY in, HAZE_EVENT_DMA_DONE out),
+ * so the consumer thread blocks instead of spinning and its idle time is measurable.
+ */
+typedef struct {
+    HazeWorkspace ws;
+    const u32 *input;                   // Frame submitted with HAZE_EVENT_FRAME_READY
+    HazeStreamWriter out;               // Destination of processed frames
+    HazeEncoder enc;                    // In-pipeline encoder for -F qoi
+    double total_ms;                    // Accumulated engine time
+    int write_failed;                   // Set by the completion callback
+} HazeDevice;
+
+static void *device_thread(void *arg) {
+    HazeDevice *dev = (HazeDevice *)arg;
+    XTime t_start, t_end;
+
+    while (haze_event_wait(HAZE_EVENT_FRAME_READY | HAZE_EVENT_SHUTDOWN) == HAZE_EVENT_FRAME_READY) {
+        XTime_GetTime(&t_start);
+        dehaze_frame(&dev->ws, dev->input, FinalData, &Ac);
+        XTime_GetTime(&t_end);
+        dev->total_ms += ((double)(t_end - t_start) * 1000.0) / (double)COUNTS_PER_SECOND;
+
+        // Outside the timed region: the fp32 shadow run is not part of the tier's cost
+        if (dev->ws.precision_report)
+            haze_precision_compare(&dev->ws, &Ac, FinalData);
+
+        // Equivalent of ProcessingCompletionISR()
+        STATS_ISR_STAMP();
+        haze_event_post(HAZE_EVENT_DMA_DONE);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Completion callback (event worker thread): ship the processed frame
+ */
+static void frame_done_callback(u32 events, void *ref) {
+    HazeDevice *dev = (HazeDevice *)ref;
+    (void)events;
+    STATS_ISR_WAKEUP();
+
+    int status = dev->ws.encoder
+               ? haze_stream_write_bytes(&dev->out, dev->enc.buf, dev->enc.size)
+               : haze_stream_write(&dev->out, FinalData);
+    if (status != 0) {
+        LOG("ERROR: Failed to write output frame\n");
+        STATS_FRAME_DROPPED();
+        dev->write_failed = 1;
+    }
+}
+
+static double thread_cpu_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static void usage(const char *prog) {
+    LOG("Usage: %s [-f y4m|rgb24|xrgb32] [-F y4m|rgb24|xrgb32|qoi] [-i input] [-o output]\n"
+        "       [-a] [-p sigma|d_threshold|omega|t0|beta=value ...] [-q fp32|fp16|fixed] [-e]\n",
+        prog);
+}
+
+/**
+ * @brief Apply one "name=value" parameter override
+ * @return 0 on success, -1 for an unknown name or malformed value
+ */
+static int parse_param(HazeParams *p, const char *arg) {
+    const char *eq = strchr(arg, '=');
+    char *end;
+    double v;
+
+    if (!eq)
+        return -1;
+    v = strtod(eq + 1, &end);
+    if (end == eq + 1 || *end != '\0')
+        return -1;
+
+    if (strncmp(arg, "sigma=", 6) == 0)             p->sigma = (float)v;
+    else if (strncmp(arg, "d_threshold=", 12) == 0) p->d_threshold = (int)v;
+    else if (strncmp(arg, "omega=", 6) == 0)        p->omega = (float)v;
+    else if (strncmp(arg, "t0=", 3) == 0)           p->t0 = (float)v;
+    else if (strncmp(arg, "beta=", 5) == 0)         p->beta = (float)v;
+    else return -1;
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    static HazeDevice dev;
+    static HazeStreamReader in;
+    pthread_t device;
+    XTime t_submit, t_done;
+    double busy_ms = 0.0, consumer_cpu_ms = 0.0;
+    HazeStream_Format in_fmt = HAZE_FMT_XRGB32, out_fmt = HAZE_FMT_RGB24;
+    const char *in_path = NULL, *out_path = NULL;
+    HazeParams params = HazeParamsDefault;
+    const u32 *frame;
+    HazePrecision precision = HAZE_PRECISION;
+    int frames = 0, out_set = 0, auto_tune = HAZE_AUTO_TUNE, report = 0, failed, opt;
+
+    while ((opt = getopt(argc, argv, "f:F:i:o:ap:q:e")) != -1) {
+        switch (opt) {
+            case 'f':
+                if (haze_stream_parse_format(optarg, &in_fmt) != 0) {
+                    usage(argv[0]);
+                    return -1;
+                }
+                if (!out_set)
+                    out_fmt = in_fmt;
+                break;
+            case 'F':
+                if (haze_stream_parse_format(optarg, &out_fmt) != 0) {
+                    usage(argv[0]);
+                    return -1;
+                }
+                out_set = 1;
+                break;
+            case 'i': in_path = optarg; break;
+            case 'o': out_path = optarg; break;
+            case 'a': auto_tune = 1; break;
+            case 'p':
+                if (parse_param(&params, optarg) != 0) {
+                    LOG("ERROR: Bad parameter '%s'\n", optarg);
+                    usage(argv[0]);
+                    return -1;
+                }
+                break;
+            case 'q':
+                if (haze_precision_parse(optarg, &precision) != 0) {
+                    usage(argv[0]);
+                    return -1;
+                }
+                break;
+            case 'e': report = 1; break;
+            default:
+                usage(argv[0]);
+                return -1;
+        }
+    }
+
+    if (haze_workspace_alloc(&dev.ws) != 0) {
+        LOG("ERROR: Failed to allocate main working buffers\n");
+        return -1;
+    }
+    if (haze_set_params(&dev.ws, &params) != 0) {
+        haze_workspace_free(&dev.ws);
+        return -1;
+    }
+    dev.ws.auto_tune = auto_tune;
+    dev.ws.precision = precision;
+    dev.ws.precision_report = report;
+
+    // Frames are decoded ahead on the stream's I/O thread while the device works
+    if (haze_stream_reader_open(&in, in_path, in_fmt) != 0) {
+        haze_workspace_free(&dev.ws);
+        return -1;
+    }
+    if (haze_stream_writer_open(&dev.out, out_path, out_fmt, &in) != 0) {
+        haze_stream_reader_close(&in);
+        haze_workspace_free(&dev.ws);
+        return -1;
+    }
+    if (out_fmt == HAZE_FMT_QOI) {
+        if (haze_encoder_init(&dev.enc, IMG_WIDTH, IMG_HEIGHT) != 0) {
+            LOG("ERROR: Failed to start output encoder\n");
+            haze_stream_writer_close(&dev.out);
+            haze_stream_reader_close(&in);
+            haze_workspace_free(&dev.ws);
+            return -1;
+        }
+        dev.ws.encoder = &dev.enc;
+    }
+
+    // Without the event worker or the device thread the first wait would never return
+    int started = haze_event_init() == 0;
+    if (started) {
+        haze_event_register(HAZE_EVENT_DMA_DONE, frame_done_callback, &dev);
+        if (pthread_create(&device, NULL, device_thread, &dev) != 0) {
+            haze_event_shutdown();
+            started = 0;
+        }
+    }
+    if (!started) {
+        LOG("ERROR: Failed to start the device threads\n");
+        haze_stream_writer_close(&dev.out);
+        haze_stream_reader_close(&in);
+        if (dev.ws.encoder)
+            haze_encoder_close(&dev.enc);
+        haze_workspace_free(&dev.ws);
+        return -1;
+    }
+
+    while (!dev.write_failed && (frame = haze_stream_next(&in)) != NULL) {
+        double cpu0 = thread_cpu_ms();
+        XTime_GetTime(&t_submit);
+
+        dev.input = frame;
+        haze_event_post(HAZE_EVENT_FRAME_READY);
+
+        // Sleep until the device is done, then hand the slot back to the reader
+        haze_event_wait(HAZE_EVENT_DMA_DONE);
+        haze_stream_release(&in);
+
+        XTime_GetTime(&t_done);
+        busy_ms += ((double)(t_done - t_submit) * 1000.0) / (double)COUNTS_PER_SECOND;
+        consumer_cpu_ms += thread_cpu_ms() - cpu0;
+        frames++;
+    }
+    failed = in.error || dev.write_failed;
+    if (in.error) {
+        LOG("ERROR: Truncated or malformed input frame after %d frames\n", frames);
+        STATS_FRAME_DROPPED();
+    }
+
+    haze_event_post(HAZE_EVENT_SHUTDOWN);
+    pthread_join(device, NULL);
+    haze_event_shutdown();
+
+    if (frames > 0) {
+        // Machine-readable summary parsed by Python/Regression_Suite.py
+        LOG("FRAMES %d TIME_MS %.3f MPIX_S %.3f\n", frames, dev.total_ms,
+            ((double)IMG_SIZE * frames / 1000000.0) / (dev.total_ms / 1000.0));
+        // Share of the consumer core left free while the device was busy
+        LOG("HOST_IDLE_PCT %.1f\n", 100.0 * (1.0 - consumer_cpu_ms / busy_ms));
+    }
+    if (dev.ws.encoder && dev.enc.frames > 0) {
+        double ratio, enc_mpix_s;
+
+        haze_encoder_report(&dev.enc, &ratio, &enc_mpix_s);
+        LOG("ENCODE qoi RATIO %.3f MPIX_S %.3f\n", ratio, enc_mpix_s);
+    }
+    if (dev.ws.precision_report && dev.ws.prec_err.frames > 0) {
+        const HazePrecisionError *err = &dev.ws.prec_err;
+        double mse = err->out_sq_err / err->out_bytes;
+
+        LOG("PRECISION %s T_MAX_ERR %.6f PSNR %.2f MAX_DIFF %u\n",
+            HazePrecisionNames[dev.ws.precision], err->t_max_err,
+            (mse > 0.0) ? 10.0 * log10(255.0 * 255.0 / mse) : INFINITY,
+            (unsigned)err->out_max_diff);
+    }
+    STATS_DUMP();
+
+    haze_stream_writer_close(&dev.out);
+    haze_stream_reader_close(&in);
+    if (dev.ws.encoder)
+        haze_encoder_close(&dev.enc);
+    haze_workspace_free(&dev.ws);
+    return failed ? -1 : 0;
+}
+#else
 //==========================================================================================
 // MAIN FUNCTION
 //==========================================================================================
 int main(void) {
     XUartPs_Config *UART_Config;
     XUartPs UART_Instance;
+    HazeWorkspace ws;
     u32 status;
     XTime t_start, t_end;
-    int loc_s = 0, loc_t = 0;
-    
+    const u8 *tx_data = FinalData;
+    u32 tx_bytes = NUMBER_OF_BYTES;
+#if HAZE_ENCODE_OUTPUT
+    static HazeEncoder enc;
+#endif
+
     // Allocate large working buffers
-    float *img_float = (float*)malloc(sizeof(float) * IMG_SIZE * 3);
-    float *t_map = (float*)malloc(sizeof(float) * IMG_SIZE);
-    u8 *ED_map = (u8*)malloc(sizeof(u8) * IMG_SIZE);
-    
-    if (!img_float || !t_map || !ED_map) {
+    if (haze_workspace_alloc(&ws) != 0) {
         xil_printf("ERROR: Failed to allocate main working buffers\n");
-        if (img_float) free(img_float);
-        if (t_map) free(t_map);
-        if (ED_map) free(ED_map);
         return -1;
     }
-    
-    // Allocate scratch buffers for intermediate results
-    float *s_minR = (float*)malloc(sizeof(float) * IMG_SIZE);
-    float *s_minG = (float*)malloc(sizeof(float) * IMG_SIZE);
-    float *s_minB = (float*)malloc(sizeof(float) * IMG_SIZE);
-    
-    float *tmp0_r = (float*)malloc(sizeof(float) * IMG_SIZE);
-    float *tmp0_g = (float*)malloc(sizeof(float) * IMG_SIZE);
-    float *tmp0_b = (float*)malloc(sizeof(float) * IMG_SIZE);
-    float *tmp1_r = (float*)malloc(sizeof(float) * IMG_SIZE);
-    float *tmp1_g = (float*)malloc(sizeof(float) * IMG_SIZE);
-    float *tmp1_b = (float*)malloc(sizeof(float) * IMG_SIZE);
-    float *tmp2_r = (float*)malloc(sizeof(float) * IMG_SIZE);
-    float *tmp2_g = (float*)malloc(sizeof(float) * IMG_SIZE);
-    float *tmp2_b = (float*)malloc(sizeof(float) * IMG_SIZE);
-    
-    float *j_r = (float*)malloc(sizeof(float) * IMG_SIZE);
-    float *j_g = (float*)malloc(sizeof(float) * IMG_SIZE);
-    float *j_b = (float*)malloc(sizeof(float) * IMG_SIZE);
-    
-    if (!s_minR || !s_minG || !s_minB ||
-        !tmp0_r || !tmp0_g || !tmp0_b ||
-        !tmp1_r || !tmp1_g || !tmp1_b ||
-        !tmp2_r || !tmp2_g || !tmp2_b ||
-        !j_r || !j_g || !j_b) {
-        xil_printf("ERROR: Failed to allocate scratch buffers\n");
-        goto cleanup_and_exit;
+#if HAZE_ENCODE_OUTPUT
+    if (haze_encoder_init(&enc, IMG_WIDTH, IMG_HEIGHT) != 0) {
+        xil_printf("ERROR: Failed to allocate output encoder buffer\n");
+        haze_workspace_free(&ws);
+        return -1;
     }
-    
+    ws.encoder = &enc;
+#endif
+
     //==================================================================================
     // UART INITIALIZATION
     //==================================================================================
@@ -420,69 +1436,46 @@ int main(void) {
         xil_printf("ERROR: UART initialization failed\n");
         goto cleanup_and_exit;
     }
-    
+
     status = XUartPs_SetBaudRate(&UART_Instance, BAUD_RATE);
     if (status != XST_SUCCESS) {
         xil_printf("ERROR: UART baud rate configuration failed\n");
         goto cleanup_and_exit;
     }
-    
+
     xil_printf("\n=== Software Haze Removal Started ===\n");
     xil_printf("Image size: %dx%d pixels\n", IMG_WIDTH, IMG_HEIGHT);
-    
+
     //==================================================================================
     // IMAGE PROCESSING PIPELINE
     //==================================================================================
     Xil_DCacheFlush();
     XTime_GetTime(&t_start);
-    
-    // Step 1: Convert to planar float format
-    xil_printf("[1/6] Converting image format...\n");
-    float *img_r = img_float;
-    float *img_g = img_float + IMG_SIZE;
-    float *img_b = img_float + IMG_SIZE * 2;
-    convert_to_float_planar(imageData, img_float);
-    
-    // Step 2: Atmospheric light estimation
-    xil_printf("[2/6] Computing atmospheric light...\n");
-    compute_atmospheric_light(img_r, img_g, img_b, &Ac, &loc_s, &loc_t, s_minR, s_minG, s_minB);
-    xil_printf("      Ac = (R:%.2f, G:%.2f, B:%.2f) at pixel (%d,%d)\n",
-               Ac.r, Ac.g, Ac.b, loc_s, loc_t);
-    
-    // Step 3: Edge detection map
-    xil_printf("[3/6] Computing edge detection map...\n");
-    compute_ED_map(img_r, img_g, img_b, ED_map);
-    
-    // Step 4: Transmission estimation
-    xil_printf("[4/6] Estimating transmission map...\n");
-    estimate_transmission(img_r, img_g, img_b, &Ac, ED_map, t_map,
-                         tmp0_r, tmp0_g, tmp0_b,
-                         tmp1_r, tmp1_g, tmp1_b,
-                         tmp2_r, tmp2_g, tmp2_b);
-    
-    // Step 5: Scene recovery
-    xil_printf("[5/6] Recovering scene radiance...\n");
-    recover_scene(img_r, img_g, img_b, &Ac, t_map, j_r, j_g, j_b);
-    
-    // Step 6: Saturation correction
-    xil_printf("[6/6] Applying saturation correction...\n");
-    saturation_correction_and_pack(j_r, j_g, j_b, &Ac, FinalData);
-    
+
+    dehaze_frame(&ws, imageData, FinalData, &Ac);
+
     Xil_DCacheFlush();
     XTime_GetTime(&t_end);
-    
+
+#if HAZE_ENCODE_OUTPUT
+    tx_data = enc.buf;
+    tx_bytes = enc.size;
+#endif
+
     //==================================================================================
     // UART TRANSMISSION
     //==================================================================================
-    xil_printf("Transmitting %d bytes via UART...\n", NUMBER_OF_BYTES);
+    xil_printf("Transmitting %d bytes via UART...\n", tx_bytes);
     u32 total_sent = 0;
     u32 retry_count = 0;
-    
-    while (total_sent < NUMBER_OF_BYTES) {
+    u32 next_report = tx_bytes / 4;
+
+    while (total_sent < tx_bytes) {
+        u32 burst = (tx_bytes - total_sent < BURST_SIZE) ? tx_bytes - total_sent : BURST_SIZE;
         u32 sent = XUartPs_Send(&UART_Instance,
-                                (u8*)&FinalData[total_sent],
-                                BURST_SIZE);
-        
+                                (u8*)&tx_data[total_sent],
+                                burst);
+
         if (sent == 0) {
             // UART FIFO full - back off
             usleep(1000);  // 1ms delay
@@ -493,21 +1486,22 @@ int main(void) {
             }
             continue;
         }
-        
+
         total_sent += sent;
         retry_count = 0;
-        
+
         // Wait for transmission to complete
         while (XUartPs_IsSending(&UART_Instance)) {
             usleep(100);  // 100us
         }
-        
+
         // Progress indicator every 25%
-        if ((total_sent % (NUMBER_OF_BYTES / 4)) == 0) {
-            xil_printf("  %d%% transmitted\n", (total_sent * 100) / NUMBER_OF_BYTES);
+        if (total_sent >= next_report) {
+            xil_printf("  %d%% transmitted\n", (total_sent * 100) / tx_bytes);
+            next_report += tx_bytes / 4;
         }
     }
-    
+
     //==================================================================================
     // PERFORMANCE REPORTING
     //==================================================================================
@@ -515,31 +1509,22 @@ int main(void) {
     xil_printf("\n=== Processing Complete ===\n");
     xil_printf("Execution Time: %.2f ms\n", elapsed_ms);
     xil_printf("Throughput: %.2f Mpixels/sec\n", (IMG_SIZE / 1000000.0) / (elapsed_ms / 1000.0));
+#if HAZE_ENCODE_OUTPUT
+    double enc_ratio, enc_mpix_s;
+    haze_encoder_report(&enc, &enc_ratio, &enc_mpix_s);
+    printf("Encoder: QOI %u bytes, ratio %.2f, %.2f Mpixels/sec\n",      // xil_printf has no %f
+           (unsigned)tx_bytes, enc_ratio, enc_mpix_s);
+#endif
     xil_printf("============================\n\r");
-    
+    STATS_DUMP();
+
 cleanup_and_exit:
     // Free all allocated memory
-    if (s_minR) free(s_minR);
-    if (s_minG) free(s_minG);
-    if (s_minB) free(s_minB);
-    
-    if (tmp0_r) free(tmp0_r);
-    if (tmp0_g) free(tmp0_g);
-    if (tmp0_b) free(tmp0_b);
-    if (tmp1_r) free(tmp1_r);
-    if (tmp1_g) free(tmp1_g);
-    if (tmp1_b) free(tmp1_b);
-    if (tmp2_r) free(tmp2_r);
-    if (tmp2_g) free(tmp2_g);
-    if (tmp2_b) free(tmp2_b);
-    
-    if (j_r) free(j_r);
-    if (j_g) free(j_g);
-    if (j_b) free(j_b);
-    
-    if (img_float) free(img_float);
-    if (t_map) free(t_map);
-    if (ED_map) free(ED_map);
-    
+#if HAZE_ENCODE_OUTPUT
+    haze_encoder_close(&enc);
+#endif
+    haze_workspace_free(&ws);
+
     return 0;
 }
+#endif